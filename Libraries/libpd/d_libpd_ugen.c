@@ -0,0 +1,39 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+/* d_ugen.c with access to the dsp chain and signal free lists of an instance.
+This is compiled in place of d_ugen.c, so the accessors use pd's own definitions. */
+
+#include "d_ugen.c"
+#include "d_libpd_ugen.h"
+
+#if MAXLOGSIG + 1 != LIBPD_UGEN_NFREELISTS
+#error "LIBPD_UGEN_NFREELISTS doesn't match the free lists in d_ugen.c"
+#endif
+
+int libpd_ugen_getchainsize(void)
+{
+    return THIS->u_dspchainsize;
+}
+
+void libpd_ugen_holdsignals(t_libpd_ugen_heldsignals *held)
+{
+    int i;
+    for (i = 0; i < LIBPD_UGEN_NFREELISTS; i++)
+    {
+        held->h_freelist[i] = THIS->u_freelist[i];
+        THIS->u_freelist[i] = 0;
+    }
+}
+
+    /* the signals freed in between stay in the instance's signal list, and are
+    freed along with the others when the chain is rebuilt */
+void libpd_ugen_releasesignals(t_libpd_ugen_heldsignals *held)
+{
+    int i;
+    for (i = 0; i < LIBPD_UGEN_NFREELISTS; i++)
+        THIS->u_freelist[i] = held->h_freelist[i];
+}
@@ -0,0 +1,33 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#include <m_pd.h>
+
+/* one free list per power of two signal size, MAXLOGSIG + 1 in d_ugen.c */
+#define LIBPD_UGEN_NFREELISTS 33
+
+typedef struct _libpd_ugen_heldsignals
+{
+    t_signal *h_freelist[LIBPD_UGEN_NFREELISTS];
+} t_libpd_ugen_heldsignals;
+
+/* number of entries in the dsp chain of the current instance, including the dsp_done that ends it */
+int libpd_ugen_getchainsize(void);
+
+/* keeps the signals that are freed from now on out of the free lists of the current instance,
+until the matching release, so nothing built afterwards gets their buffers */
+void libpd_ugen_holdsignals(t_libpd_ugen_heldsignals *held);
+void libpd_ugen_releasesignals(t_libpd_ugen_heldsignals *held);
+
+#ifdef __cplusplus
+}
+#endif
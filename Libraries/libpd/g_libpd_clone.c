@@ -0,0 +1,26 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+/* g_clone.c with access to the class and voices of clone, which g_clone.c keeps private.
+This is compiled in place of g_clone.c, so the accessors use pd's own definitions. */
+
+#include "g_clone.c"
+#include "g_libpd_clone.h"
+
+t_class *libpd_clone_getclass(void)
+{
+    return clone_class;
+}
+
+int libpd_clone_getnumvoices(t_object *x)
+{
+    return ((t_clone *)x)->x_n;
+}
+
+t_glist *libpd_clone_getvoice(t_object *x, int index)
+{
+    return ((t_clone *)x)->x_vec[index].c_gl;
+}
@@ -0,0 +1,23 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+#include <m_pd.h>
+#include <g_canvas.h>
+
+t_class *libpd_clone_getclass(void);
+
+int libpd_clone_getnumvoices(t_object *x);
+t_glist *libpd_clone_getvoice(t_object *x, int index);
+
+#ifdef __cplusplus
+}
+#endif
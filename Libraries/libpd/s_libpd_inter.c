@@ -35,6 +35,7 @@ that didn't really belong anywhere. */
 #include <fcntl.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
 
 #ifdef __APPLE__
 #include <glob.h>
@@ -103,6 +104,27 @@ typedef struct _guiqueue
     struct _guiqueue *gq_next;
 } t_guiqueue;
 
+/* change tracking for arrays, so the gui only has to copy what changed */
+#define ARRAY_SLOTS 64
+#define ARRAY_HISTORY 8
+
+typedef struct _arraychange
+{
+    unsigned int c_generation;
+    int c_start;
+    int c_end;
+} t_arraychange;
+
+typedef struct _arraystate
+{
+    void *a_array;
+    unsigned int a_generation;  /* generation of the last change */
+    unsigned int a_lost;        /* ranges of changes up to here are unknown */
+    int a_nchanges;
+    int a_head;
+    t_arraychange a_changes[ARRAY_HISTORY];
+} t_arraystate;
+
 struct _instanceinter
 {
     int i_havegui;
@@ -127,6 +149,17 @@ struct _instanceinter
 #endif
 #if PDTHREADS
     pthread_mutex_t i_mutex;
+
+        /* fds are waited on by a poll thread instead of the audio thread */
+    pthread_t i_pollthread;
+    pthread_mutex_t i_pollmutex;    /* guards the fields below */
+    int i_pollthreadstarted;
+    int i_pollthreadoff;            /* turned off by sys_setpollthread() */
+    int i_pollquit;
+    fd_set i_pollset;               /* copy of the fds in i_fdpoll */
+    int i_pollmaxfd;
+    int i_pollready;                /* set when i_pollreadyset needs handling */
+    fd_set i_pollreadyset;
 #endif
 
     unsigned char i_recvbuf[NET_MAXPACKETSIZE];
@@ -134,12 +167,28 @@ struct _instanceinter
     pd_gui_callback gui_callback;
     pd_panel_callback panel_callback;
     pd_synchronise_callback synchronise_callback;
+    pd_canvasfree_callback canvasfree_callback;
     void* callback_target;
+
+    t_arraystate i_arrays[ARRAY_SLOTS];
+    unsigned int i_arraygeneration;
     
     
 };
 
-void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback gui_callback, pd_panel_callback panel_callback, pd_synchronise_callback synchronise_callback) {
+    /* canvas_class is shared by all instances, so its free method is only
+    wrapped once and the wrapper looks up the callback of the current instance */
+static t_method canvas_freemethod;
+
+static void canvas_free_notify(t_canvas *x)
+{
+    if(pd_this->pd_inter->canvasfree_callback) {
+        pd_this->pd_inter->canvasfree_callback(pd_this->pd_inter->callback_target, x);
+    }
+    (*(void(*)(t_canvas *))canvas_freemethod)(x);
+}
+
+void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback gui_callback, pd_panel_callback panel_callback, pd_synchronise_callback synchronise_callback, pd_canvasfree_callback canvasfree_callback) {
     
 #if !PDINSTANCE
     instance = &pd_maininstance;
@@ -148,8 +197,15 @@ void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback
     instance->pd_inter->gui_callback = gui_callback;
     instance->pd_inter->panel_callback = panel_callback;
     instance->pd_inter->synchronise_callback = synchronise_callback;
+    instance->pd_inter->canvasfree_callback = canvasfree_callback;
     instance->pd_inter->callback_target = target;
 
+    if (!canvas_freemethod)
+    {
+        canvas_freemethod = canvas_class->c_freemethod;
+        canvas_class->c_freemethod = (t_method)canvas_free_notify;
+    }
+
 
 }
 
@@ -159,6 +215,67 @@ void update_gui(void* obj_target) {
     }
 }
 
+static t_arraystate *array_getstate(void *array)
+{
+    t_arraystate *states = INTER->i_arrays, *slot = NULL;
+    int hash = (int)(((size_t)array >> 4) % ARRAY_SLOTS), i;
+    for (i = 0; i < ARRAY_SLOTS; i++)
+    {
+        t_arraystate *a = states + (hash + i) % ARRAY_SLOTS;
+        if (a->a_array == array)
+            return (a);
+        if (!a->a_array && !slot)
+            slot = a;
+    }
+        /* not tracked yet (or evicted), so anything before now is unknown */
+    if (!slot)
+        slot = states + hash;
+    memset(slot, 0, sizeof(*slot));
+    slot->a_array = array;
+    slot->a_generation = slot->a_lost = ++INTER->i_arraygeneration;
+    return (slot);
+}
+
+    /* call with the PD instance lock set */
+void update_array(void *array, int start, int end)
+{
+    t_arraystate *a = array_getstate(array);
+    t_arraychange *c = a->a_changes + a->a_head;
+    if (a->a_nchanges == ARRAY_HISTORY)
+        a->a_lost = c->c_generation;
+    else a->a_nchanges++;
+    a->a_head = (a->a_head + 1) % ARRAY_HISTORY;
+    c->c_generation = a->a_generation = ++INTER->i_arraygeneration;
+    c->c_start = start;
+    c->c_end = end;
+}
+
+    /* call with the PD instance lock set */
+unsigned int get_array_changes(void *array, unsigned int since,
+    int *start, int *end)
+{
+    t_arraystate *a = array_getstate(array);
+    int i;
+    *start = INT_MAX;
+    *end = 0;
+    if (since < a->a_lost)
+        *start = 0, *end = INT_MAX;
+    else for (i = 0; i < a->a_nchanges; i++)
+    {
+        t_arraychange *c = a->a_changes + i;
+        if (c->c_generation > since)
+        {
+            if (c->c_start < *start)
+                *start = c->c_start;
+            if (c->c_end > *end)
+                *end = c->c_end;
+        }
+    }
+    if (*start >= *end)
+        *start = *end = 0;
+    return (a->a_generation);
+}
+
 void synchronise_canvas(void* cnv_target) {
     if(pd_this->pd_inter->synchronise_callback) {
         pd_this->pd_inter->synchronise_callback(pd_this->pd_inter->callback_target, cnv_target);
@@ -283,6 +400,152 @@ static int sys_domicrosleep(int microsec)
     return (0);
 }
 
+#if PDTHREADS
+#define POLLTHREAD_TIMEOUT 10000    /* usec, how often the fd list is picked up */
+
+static void sys_pollthread_sleep(void)
+{
+#ifdef _WIN32
+    Sleep(1);
+#else
+    usleep(1000);
+#endif
+}
+
+    /* wait for incoming data on the registered fds, so the audio thread
+    doesn't need a select() call on every block.  The callbacks read from
+    the fds and dispatch into the patch, so they still run on the audio
+    thread with the instance locked; this thread only reports which fds
+    are ready, and waits until the audio thread has handled them. */
+static void *sys_pollthread(void *arg)
+{
+    t_instanceinter *inter = (t_instanceinter *)arg;
+    while (1)
+    {
+        fd_set readset;
+        struct timeval timeout;
+        int maxfd, ready, quit, result;
+
+        pthread_mutex_lock(&inter->i_pollmutex);
+        quit = inter->i_pollquit;
+        ready = inter->i_pollready;
+        readset = inter->i_pollset;
+        maxfd = inter->i_pollmaxfd;
+        pthread_mutex_unlock(&inter->i_pollmutex);
+
+        if (quit)
+            break;
+        if (ready || maxfd <= 0)
+        {
+            sys_pollthread_sleep();
+            continue;
+        }
+
+        timeout.tv_sec = 0;
+        timeout.tv_usec = POLLTHREAD_TIMEOUT;
+        result = select(maxfd, &readset, 0, 0, &timeout);
+        if (result > 0)
+        {
+            pthread_mutex_lock(&inter->i_pollmutex);
+            inter->i_pollreadyset = readset;
+            inter->i_pollready = 1;
+            pthread_mutex_unlock(&inter->i_pollmutex);
+        }
+            /* an fd got closed before it was removed from the list */
+        else if (result < 0)
+            sys_pollthread_sleep();
+    }
+    return (0);
+}
+
+    /* keep the poll thread's copy of the fd list up to date, and start
+    the thread when the first fd comes in.  Called with sys_lock() set. */
+static void sys_pollthread_update(void)
+{
+    int i;
+    pthread_mutex_lock(&INTER->i_pollmutex);
+    FD_ZERO(&INTER->i_pollset);
+    INTER->i_pollmaxfd = 0;
+    for (i = 0; i < INTER->i_nfdpoll; i++)
+    {
+        FD_SET(INTER->i_fdpoll[i].fdp_fd, &INTER->i_pollset);
+        if (INTER->i_fdpoll[i].fdp_fd >= INTER->i_pollmaxfd)
+            INTER->i_pollmaxfd = INTER->i_fdpoll[i].fdp_fd + 1;
+    }
+    pthread_mutex_unlock(&INTER->i_pollmutex);
+
+    if (INTER->i_pollthreadstarted || INTER->i_pollthreadoff ||
+        !INTER->i_nfdpoll)
+            return;
+        /* the thread isn't running, so its fields need no lock */
+    INTER->i_pollquit = 0;
+    INTER->i_pollready = 0;
+    if (!pthread_create(&INTER->i_pollthread, 0, sys_pollthread, INTER))
+        INTER->i_pollthreadstarted = 1;
+}
+
+static void sys_pollthread_stop(t_instanceinter *inter)
+{
+    if (!inter->i_pollthreadstarted)
+        return;
+    pthread_mutex_lock(&inter->i_pollmutex);
+    inter->i_pollquit = 1;
+    pthread_mutex_unlock(&inter->i_pollmutex);
+    pthread_join(inter->i_pollthread, 0);
+    inter->i_pollthreadstarted = 0;
+}
+#endif /* PDTHREADS */
+
+    /* without the poll thread, fds are polled with select() from
+    sys_pollgui() again, so both can be compared.  Call with the instance
+    locked. */
+void sys_setpollthread(int on)
+{
+#if PDTHREADS
+    INTER->i_pollthreadoff = !on;
+    if (on)
+        sys_pollthread_update();
+    else sys_pollthread_stop(INTER);
+#endif
+}
+
+    /* run the callbacks of the fds that are ready to read.  With the poll
+    thread running, this is a trylock and no syscall; a busy lock just
+    leaves the fds for the next block.  Called with sys_lock() set. */
+static int sys_pollfds(void)
+{
+#if PDTHREADS
+    fd_set readset;
+    int i, didsomething = 0;
+    if (!INTER->i_pollthreadstarted)
+        return (sys_domicrosleep(0));
+    if (pthread_mutex_trylock(&INTER->i_pollmutex))
+        return (0);
+    if (!INTER->i_pollready)
+    {
+        pthread_mutex_unlock(&INTER->i_pollmutex);
+        return (0);
+    }
+    readset = INTER->i_pollreadyset;
+    INTER->i_pollready = 0;
+    pthread_mutex_unlock(&INTER->i_pollmutex);
+
+    INTER->i_fdschanged = 0;
+    for (i = 0; i < INTER->i_nfdpoll &&
+        !INTER->i_fdschanged; i++)
+            if (FD_ISSET(INTER->i_fdpoll[i].fdp_fd, &readset))
+    {
+        (*INTER->i_fdpoll[i].fdp_fn)
+            (INTER->i_fdpoll[i].fdp_ptr,
+                INTER->i_fdpoll[i].fdp_fd);
+        didsomething = 1;
+    }
+    return (didsomething);
+#else
+    return (sys_domicrosleep(0));
+#endif
+}
+
     /* sleep (but if any incoming or to-gui sending to do, do that instead.)
     Call with the PD instance lock UNSET - we set it here. */
 void sys_microsleep( void)
@@ -464,6 +727,9 @@ void sys_addpollfn(int fd, t_fdpollfn fn, void *ptr)
     if (fd >= INTER->i_maxfd)
         INTER->i_maxfd = fd + 1;
     INTER->i_fdschanged = 1;
+#if PDTHREADS
+    sys_pollthread_update();
+#endif
 }
 
 void sys_rmpollfn(int fd)
@@ -484,6 +750,9 @@ void sys_rmpollfn(int fd)
             INTER->i_fdpoll = (t_fdpoll *)t_resizebytes(
                 INTER->i_fdpoll, size, size - sizeof(t_fdpoll));
             INTER->i_nfdpoll = nfd - 1;
+#if PDTHREADS
+            sys_pollthread_update();
+#endif
             return;
         }
     }
@@ -809,6 +1078,19 @@ int sys_havegui(void)
 
 void sys_vgui(const char *fmt, ...)
 {
+    // Drawing commands don't say which object they draw, like the toggles and bangs that redraw themselves, so
+    // they refresh everything. Only pdtk_ commands need to be looked at, skip the string compares for the rest
+    if (fmt[0] != 'p' || strncmp(fmt, "pdtk_", 5) != 0)
+    {
+        update_gui(NULL);
+        return;
+    }
+
+    // Atom boxes queue their text through sys_queuegui, which reports the atom itself
+    if(strncmp(fmt, "pdtk_text_", strlen("pdtk_text_")) == 0) {
+        return;
+    }
+
     // This call causes a circular loop, so ignore it
     if(strncmp(fmt, "pdtk_canvas_raise", strlen("pdtk_canvas_raise")) == 0) {
         return;
@@ -856,10 +1138,6 @@ void sys_vgui(const char *fmt, ...)
         synchronise_canvas(cnv);
     } */
 
-
-    
-    
-    
     update_gui(NULL);
 }
 
@@ -970,8 +1248,13 @@ void sys_pretendguibytes(int n)
     INTER->i_bytessincelastping += n;
 }
 
+    /* the gui draws from pd's data directly, so instead of queueing the redraw
+    this is where objects tell us they changed, like sliders, number boxes,
+    atom boxes and arrays */
 void sys_queuegui(void *client, t_glist *glist, t_guicallbackfn f)
 {
+  if (pd_class((t_pd *)client) == garray_class)
+    update_array(client, 0, INT_MAX);
   update_gui(client);
 }
 
@@ -1002,7 +1285,7 @@ int sys_pollgui(void)
 {
     static double lasttime = 0;
     double now = 0;
-    int didsomething = sys_domicrosleep(0);
+    int didsomething = sys_pollfds();
     if (!didsomething || (now = sys_getrealtime()) > lasttime + 0.5)
     {
         didsomething |= sys_poll_togui();
@@ -1637,6 +1920,8 @@ void s_inter_newpdinstance(void)
     INTER = getbytes(sizeof(*INTER));
 #if PDTHREADS
     pthread_mutex_init(&INTER->i_mutex, NULL);
+    pthread_mutex_init(&INTER->i_pollmutex, NULL);
+    FD_ZERO(&INTER->i_pollset);
     pd_this->pd_islocked = 0;
 #endif
 #ifdef _WIN32
@@ -1647,6 +1932,10 @@ void s_inter_newpdinstance(void)
 
 void s_inter_free(t_instanceinter *inter)
 {
+#if PDTHREADS
+    sys_pollthread_stop(inter);
+    pthread_mutex_destroy(&inter->i_pollmutex);
+#endif
     if (inter->i_fdpoll)
     {
         binbuf_free(inter->i_inbinbuf);
@@ -5,5 +5,17 @@
 typedef void(*pd_gui_callback)(void*, void*);
 typedef void(*pd_panel_callback)(void*, int, const char*, const char*);
 typedef void(*pd_synchronise_callback)(void*, void*);
+typedef void(*pd_canvasfree_callback)(void*, void*);
 
-void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback gui_callback, pd_panel_callback panel_callback, pd_synchronise_callback synchronise_callback);
+// canvasfree_callback is called with every canvas of the instance right before pd frees it
+void register_gui_triggers(t_pdinstance* instance, void* target, pd_gui_callback gui_callback, pd_panel_callback panel_callback, pd_synchronise_callback synchronise_callback, pd_canvasfree_callback canvasfree_callback);
+
+// Array change tracking, call with the instance locked
+// Marks [start, end) of a garray as changed and bumps its generation
+void update_array(void* array, int start, int end);
+// Gets the index range that changed after generation "since", and returns the current generation
+unsigned int get_array_changes(void* array, unsigned int since, int* start, int* end);
+
+// Turns the thread that waits for socket data on or off for the current instance, call with the instance locked
+// It's on by default, without it the audio thread polls the sockets itself with every block
+void sys_setpollthread(int on);
@@ -12,6 +12,7 @@
 #include <g_canvas.h>
 #include <g_all_guis.h>
 #include "x_libpd_multi.h"
+#include "s_libpd_inter.h"
 
 // False GARRAY
 typedef struct _fake_garray
@@ -115,6 +116,30 @@ void libpd_array_get_scale(char const* name, float* min, float* max)
     *max = 1;
 }
 
+unsigned int libpd_array_get_changes(char const* name, unsigned int since, int* size, int* start, int* end)
+{
+    unsigned int generation = since;
+    t_fake_garray *array;
+    sys_lock();
+    array = libpd_array_get_byname(name);
+    if(array)
+    {
+        *size = garray_npoints((t_garray*)array);
+        generation = get_array_changes(array, since, start, end);
+        if(*end > *size)
+            *end = *size;
+        if(*start > *end)
+            *start = *end;
+    }
+    else
+    {
+        *size = -1;
+        *start = *end = 0;
+    }
+    sys_unlock();
+    return generation;
+}
+
 int libpd_array_get_style(char const* name)
 {
     t_fake_garray const *array = libpd_array_get_byname(name);
@@ -27,6 +27,8 @@ void libpd_get_object_bounds(void* patch, void* ptr, int* x, int* y, int* w, int
 char const* libpd_array_get_name(void* ptr);
 void libpd_array_get_scale(char const* name, float* min, float* max);
 int libpd_array_get_style(char const* name);
+// gets the size of an array and the index range that changed after generation "since", returns the current generation
+unsigned int libpd_array_get_changes(char const* name, unsigned int since, int* size, int* start, int* end);
 
 unsigned int libpd_iemgui_get_background_color(void* ptr);
 unsigned int libpd_iemgui_get_foreground_color(void* ptr);
@@ -5,7 +5,9 @@
  */
 
 #include <m_pd.h>
+#include <s_stuff.h>
 #include <s_net.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include "x_libpd_multi.h"
@@ -28,31 +30,31 @@ typedef struct _libpd_multi_receiver
 static void libpd_multi_receiver_bang(t_libpd_multi_receiver *x)
 {
     if(x->x_hook_bang)
-        x->x_hook_bang(x->x_ptr, x->x_sym->s_name);
+        x->x_hook_bang(x->x_ptr, x->x_sym);
 }
 
 static void libpd_multi_receiver_float(t_libpd_multi_receiver *x, t_float f)
 {
     if(x->x_hook_float)
-        x->x_hook_float(x->x_ptr, x->x_sym->s_name, f);
+        x->x_hook_float(x->x_ptr, x->x_sym, f);
 }
 
 static void libpd_multi_receiver_symbol(t_libpd_multi_receiver *x, t_symbol *s)
 {
     if(x->x_hook_symbol)
-        x->x_hook_symbol(x->x_ptr, x->x_sym->s_name, s->s_name);
+        x->x_hook_symbol(x->x_ptr, x->x_sym, s);
 }
 
 static void libpd_multi_receiver_list(t_libpd_multi_receiver *x, t_symbol *s, int argc, t_atom *argv)
 {
     if(x->x_hook_list)
-        x->x_hook_list(x->x_ptr, x->x_sym->s_name, argc, argv);
+        x->x_hook_list(x->x_ptr, x->x_sym, argc, argv);
 }
 
 static void libpd_multi_receiver_anything(t_libpd_multi_receiver *x, t_symbol *s, int argc, t_atom *argv)
 {
     if(x->x_hook_message)
-        x->x_hook_message(x->x_ptr, x->x_sym->s_name, s->s_name, argc, argv);
+        x->x_hook_message(x->x_ptr, x->x_sym, s, argc, argv);
 }
 
 static void libpd_multi_receiver_free(t_libpd_multi_receiver *x)
@@ -101,10 +103,27 @@ void* libpd_multi_receiver_new(void* ptr, char const *s,
 
 static t_class *libpd_multi_midi_class;
 
+#define LIBPD_MULTI_MIDI_QUEUESIZE 1024
+
+typedef struct _libpd_multi_midievent
+{
+    double          e_time;
+    unsigned int    e_order;
+    int             e_port;
+    int             e_size;
+    unsigned char   e_data[3];
+} t_libpd_multi_midievent;
+
 typedef struct _libpd_multi_midi
 {
     t_object    x_obj;
     void*       x_ptr;
+    t_clock*    x_clock;
+
+    // a binary min-heap on time, events at the same time keep the order they were scheduled in
+    t_libpd_multi_midievent x_events[LIBPD_MULTI_MIDI_QUEUESIZE];
+    int                     x_count;
+    unsigned int            x_order;
 
     t_libpd_multi_noteonhook            x_hook_noteon;
     t_libpd_multi_controlchangehook     x_hook_controlchange;
@@ -178,8 +197,142 @@ static void libpd_multi_midibyte(int port, int byte)
     }
 }
 
+static void libpd_multi_midi_dispatch(int port, int size, const unsigned char* data)
+{
+    int i;
+    int channel = data[0] & 0x0f;
+    switch(data[0] & 0xf0)
+    {
+        case 0x80:
+            inmidi_noteon(port, channel, data[1], 0);
+            break;
+        case 0x90:
+            inmidi_noteon(port, channel, data[1], data[2]);
+            break;
+        case 0xa0:
+            inmidi_polyaftertouch(port, channel, data[1], data[2]);
+            break;
+        case 0xb0:
+            inmidi_controlchange(port, channel, data[1], data[2]);
+            break;
+        case 0xc0:
+            inmidi_programchange(port, channel, data[1]);
+            break;
+        case 0xd0:
+            inmidi_aftertouch(port, channel, data[1]);
+            break;
+        case 0xe0:
+            inmidi_pitchbend(port, channel, (data[2] << 7) | data[1]);
+            break;
+        case 0xf0:
+            if(data[0] >= 0xf8)
+                inmidi_realtimein(port, data[0]);
+            break;
+    }
+    for(i = 0; i < size; i++)
+    {
+        inmidi_byte(port, data[i]);
+    }
+}
+
+static int libpd_multi_event_before(t_libpd_multi_midievent* a, t_libpd_multi_midievent* b)
+{
+    if(a->e_time != b->e_time)
+        return a->e_time < b->e_time;
+    // the difference survives the counter wrapping around
+    return (int)(a->e_order - b->e_order) < 0;
+}
+
+// removes the first event from the heap
+static void libpd_multi_event_pop(t_libpd_multi_midi *x)
+{
+    t_libpd_multi_midievent* events = x->x_events;
+    t_libpd_multi_midievent* last = events + --x->x_count;
+    int index = 0;
+    while(1)
+    {
+        int child = 2 * index + 1;
+        if(child >= x->x_count)
+            break;
+        if(child + 1 < x->x_count && libpd_multi_event_before(events + child + 1, events + child))
+            child++;
+        if(!libpd_multi_event_before(events + child, last))
+            break;
+        events[index] = events[child];
+        index = child;
+    }
+    events[index] = *last;
+}
+
+// fires at the logical time of the first queued event, in between dsp ticks
+static void libpd_multi_midi_tick(t_libpd_multi_midi *x)
+{
+    double now = clock_getlogicaltime();
+    while(x->x_count && x->x_events[0].e_time <= now)
+    {
+        t_libpd_multi_midievent e = x->x_events[0];
+        libpd_multi_event_pop(x);
+        libpd_multi_midi_dispatch(e.e_port, e.e_size, e.e_data);
+    }
+    if(x->x_count)
+    {
+        clock_set(x->x_clock, x->x_events[0].e_time);
+    }
+}
+
+static int libpd_multi_event_space(t_libpd_multi_midi *x)
+{
+    return LIBPD_MULTI_MIDI_QUEUESIZE - x->x_count;
+}
+
+// inserts an event in O(log n), the caller must hold the lock and check for space
+static void libpd_multi_event_insert(t_libpd_multi_midi *x, t_libpd_multi_midievent* e)
+{
+    int index = x->x_count++;
+    e->e_order = x->x_order++;
+    while(index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if(!libpd_multi_event_before(e, x->x_events + parent))
+            break;
+        x->x_events[index] = x->x_events[parent];
+        index = parent;
+    }
+    x->x_events[index] = *e;
+    if(index == 0)
+    {
+        clock_set(x->x_clock, e->e_time);
+    }
+}
+
+void libpd_multi_schedule_midi(void* ptr, int port, double offset, int size, const unsigned char* data)
+{
+    t_libpd_multi_midi* x = (t_libpd_multi_midi*)ptr;
+    t_libpd_multi_midievent e;
+    if(size < 1 || size > 3)
+        return;
+
+    e.e_port = port;
+    e.e_size = size;
+    memcpy(e.e_data, data, size);
+
+    sys_lock();
+    e.e_time = clock_getlogicaltime() + offset * STUFF->st_time_per_dsp_tick / DEFDACBLKSIZE;
+    if(libpd_multi_event_space(x) < 1)
+    {
+        // queue is full, send it right away
+        libpd_multi_midi_dispatch(port, size, data);
+    }
+    else
+    {
+        libpd_multi_event_insert(x, &e);
+    }
+    sys_unlock();
+}
+
 static void libpd_multi_midi_free(t_libpd_multi_midi *x)
 {
+    clock_free(x->x_clock);
     pd_unbind(&x->x_obj.ob_pd, gensym("#libpd_multi_midi"));
 }
 
@@ -209,6 +362,9 @@ void* libpd_multi_midi_new(void* ptr,
         sys_unlock();
         pd_bind(&x->x_obj.ob_pd, s);
         x->x_ptr = ptr;
+        x->x_clock = clock_new(x, (t_method)libpd_multi_midi_tick);
+        x->x_count = 0;
+        x->x_order = 0;
         x->x_hook_noteon        = hook_noteon;
         x->x_hook_controlchange = hook_controlchange;
         x->x_hook_programchange = hook_programchange;
@@ -727,6 +883,557 @@ void zerocross_tilde_setup(void);
 // end else objects functions declaration
 
 
+// classes that are set up on first use, sorted by name
+typedef struct _libpd_multi_lazyclass
+{
+    const char* l_name;
+    void (*l_setup)(void);
+} t_libpd_multi_lazyclass;
+
+static const t_libpd_multi_lazyclass libpd_multi_lazy_classes[] = {
+    {"Pow~", pow_tilde_setup},
+    {"above~", above_tilde_setup},
+    {"accum", accum_setup},
+    {"acos", acos_setup},
+    {"acosh", acosh_setup},
+    {"acosh~", acosh_tilde_setup},
+    {"acos~", acos_tilde_setup},
+    {"add~", add_tilde_setup},
+    {"adsr~", adsr_tilde_setup},
+    {"allpass.2nd~", setup_allpass0x2e2nd_tilde},
+    {"allpass.rev~", setup_allpass0x2erev_tilde},
+    {"allpass~", allpass_tilde_setup},
+    {"anal", anal_setup},
+    {"args", args_setup},
+    {"asin", asin_setup},
+    {"asinh", asinh_setup},
+    {"asinh~", asinh_tilde_setup},
+    {"asin~", asin_tilde_setup},
+    {"asr~", asr_tilde_setup},
+    {"atan2~", atan2_tilde_setup},
+    {"atanh", atanh_setup},
+    {"atanh~", atanh_tilde_setup},
+    {"atan~", atan_tilde_setup},
+    {"atodb", atodb_setup},
+    {"atodb~", atodb_tilde_setup},
+    {"autofade2~", autofade2_tilde_setup},
+    {"autofade~", autofade_tilde_setup},
+    {"average~", average_tilde_setup},
+    {"avg~", avg_tilde_setup},
+    {"balance~", balance_tilde_setup},
+    {"bandpass~", bandpass_tilde_setup},
+    {"bandstop~", bandstop_tilde_setup},
+    {"bangbang", bangbang_setup},
+    {"bend.in", setup_bend0x2ein},
+    {"bend.out", setup_bend0x2eout},
+    {"bicoeff", bicoeff_setup},
+    {"biquads~", biquads_tilde_setup},
+    {"bitand~", bitand_tilde_setup},
+    {"bitnot~", bitnot_tilde_setup},
+    {"bitor~", bitor_tilde_setup},
+    {"bitsafe~", bitsafe_tilde_setup},
+    {"bitshift~", bitshift_tilde_setup},
+    {"bitxor~", bitxor_tilde_setup},
+    {"blocksize~", blocksize_tilde_setup},
+    {"bondo", bondo_setup},
+    {"borax", borax_setup},
+    {"break", break_setup},
+    {"brown~", brown_tilde_setup},
+    {"bucket", bucket_setup},
+    {"buddy", buddy_setup},
+    {"buffer", buffer_setup},
+    {"buffir~", buffir_tilde_setup},
+    {"canvas.gop", setup_canvas0x2egop},
+    {"canvas.name", setup_canvas0x2ename},
+    {"canvas.pos", setup_canvas0x2epos},
+    {"canvas.setname", setup_canvas0x2esetname},
+    {"canvas.wname", setup_canvas0x2ewname},
+    {"cartopol", cartopol_setup},
+    {"cartopol~", cartopol_tilde_setup},
+    {"ceil", ceil_setup},
+    {"ceil~", ceil_tilde_setup},
+    {"cents2ratio", cents2ratio_setup},
+    {"cents2ratio~", cents2ratio_tilde_setup},
+    {"chance", chance_setup},
+    {"chance~", chance_tilde_setup},
+    {"changed", changed_setup},
+    {"changed2~", changed2_tilde_setup},
+    {"changed~", changed_tilde_setup},
+    {"change~", change_tilde_setup},
+    {"click", click_setup},
+    {"click~", click_tilde_setup},
+    {"clipnoise~", clipnoise_tilde_setup},
+    {"cmul~", cmul_tilde_setup},
+    {"coin", coin_setup},
+    {"coin~", coin_tilde_setup},
+    {"comb.filt~", setup_comb0x2efilt_tilde},
+    {"comb.rev~", setup_comb0x2erev_tilde},
+    {"comb~", comb_tilde_setup},
+    {"common.div", setup_common0x2ediv},
+    {"cosh", cosh_setup},
+    {"cosh~", cosh_tilde_setup},
+    {"cosine~", cosine_tilde_setup},
+    {"cosx~", cosx_tilde_setup},
+    {"counter", counter_setup},
+    {"count~", count_tilde_setup},
+    {"crackle~", crackle_tilde_setup},
+    {"crossover~", crossover_tilde_setup},
+    {"cross~", cross_tilde_setup},
+    {"ctl.in", setup_ctl0x2ein},
+    {"ctl.out", setup_ctl0x2eout},
+    {"curve~", curve_tilde_setup},
+    {"cusp~", cusp_tilde_setup},
+    {"cycle", cycle_setup},
+    {"cycle~", cycle_tilde_setup},
+    {"cyclone/Pow~", pow_tilde_setup},
+    {"cyclone/append", append_setup},
+    {"cyclone/clip", clip_setup},
+    {"cyclone/clip~", clip_tilde_setup},
+    {"cyclone/line~", line_tilde_setup},
+    {"cyclone/pow~", pow_tilde_setup},
+    {"cyclone/snapshot~", snapshot_tilde_setup},
+    {"dbtoa", dbtoa_setup},
+    {"dbtoa~", dbtoa_tilde_setup},
+    {"decay2~", decay2_tilde_setup},
+    {"decay~", decay_tilde_setup},
+    {"decide", decide_setup},
+    {"decode", decode_setup},
+    {"degrade~", degrade_tilde_setup},
+    {"delay~", delay_tilde_setup},
+    {"deltaclip~", deltaclip_tilde_setup},
+    {"delta~", delta_tilde_setup},
+    {"del~", del_tilde_setup},
+    {"detect~", detect_tilde_setup},
+    {"dollsym", dollsym_setup},
+    {"downsample~", downsample_tilde_setup},
+    {"downsamp~", downsamp_tilde_setup},
+    {"drive~", drive_tilde_setup},
+    {"drunk", drunk_setup},
+    {"dust2~", dust2_tilde_setup},
+    {"dust~", dust_tilde_setup},
+    {"edge~", edge_tilde_setup},
+    {"else/del~", del_tilde_setup},
+    {"envgen~", envgen_tilde_setup},
+    {"equals~", equals_tilde_setup},
+    {"eq~", eq_tilde_setup},
+    {"f2s~", f2s_tilde_setup},
+    {"factor", factor_setup},
+    {"fader~", fader_tilde_setup},
+    {"fbdelay~", fbdelay_tilde_setup},
+    {"fbsine2~", fbsine2_tilde_setup},
+    {"fbsine~", fbsine_tilde_setup},
+    {"fdn.rev~", setup_fdn0x2erev_tilde},
+    {"ffdelay~", ffdelay_tilde_setup},
+    {"float2bits", float2bits_setup},
+    {"float2sig~", float2sig_tilde_setup},
+    {"floor", floor_setup},
+    {"floor~", floor_tilde_setup},
+    {"flush", flush_setup},
+    {"fold", fold_setup},
+    {"fold~", fold_tilde_setup},
+    {"format", format_setup},
+    {"forward", forward_setup},
+    {"frameaccum~", frameaccum_tilde_setup},
+    {"framedelta~", framedelta_tilde_setup},
+    {"freq.shift~", setup_freq0x2eshift_tilde},
+    {"fromsymbol", fromsymbol_setup},
+    {"function~", function_tilde_setup},
+    {"funnel", funnel_setup},
+    {"gate", gate_setup},
+    {"gate2imp~", gate2imp_tilde_setup},
+    {"gate~", gate_tilde_setup},
+    {"gbman~", gbman_tilde_setup},
+    {"gcd", gcd_setup},
+    {"giga.rev~", setup_giga0x2erev_tilde},
+    {"glide2~", glide2_tilde_setup},
+    {"glide~", glide_tilde_setup},
+    {"gray~", gray_tilde_setup},
+    {"greaterthaneq~", greaterthaneq_tilde_setup},
+    {"greaterthan~", greaterthan_tilde_setup},
+    {"gui", gui_setup},
+    {"henon~", henon_tilde_setup},
+    {"highpass~", highpass_tilde_setup},
+    {"highshelf~", highshelf_tilde_setup},
+    {"histo", histo_setup},
+    {"hot", hot_setup},
+    {"hz2rad", hz2rad_setup},
+    {"hz2rad~", hz2rad_tilde_setup},
+    {"ikeda~", ikeda_tilde_setup},
+    {"imp2~", imp2_tilde_setup},
+    {"impulse2~", impulse2_tilde_setup},
+    {"impulse~", impulse_tilde_setup},
+    {"imp~", imp_tilde_setup},
+    {"index~", index_tilde_setup},
+    {"initmess", initmess_setup},
+    {"int~", int_tilde_setup},
+    {"iter", iter_setup},
+    {"join", join_setup},
+    {"join-inlet", join_setup},
+    {"kink~", kink_tilde_setup},
+    {"lag2~", lag2_tilde_setup},
+    {"lag~", lag_tilde_setup},
+    {"lastvalue~", lastvalue_tilde_setup},
+    {"latoocarfian~", latoocarfian_tilde_setup},
+    {"lb", lb_setup},
+    {"lessthaneq~", lessthaneq_tilde_setup},
+    {"lessthan~", lessthan_tilde_setup},
+    {"lfnoise~", lfnoise_tilde_setup},
+    {"limit", limit_setup},
+    {"lincong~", lincong_tilde_setup},
+    {"linedrive", linedrive_setup},
+    {"listfunnel", listfunnel_setup},
+    {"loadbanger", loadbanger_setup},
+    {"loadmess", loadmess_setup},
+    {"logistic~", logistic_tilde_setup},
+    {"lookup~", lookup_tilde_setup},
+    {"loop", loop_setup},
+    {"lorenz~", lorenz_tilde_setup},
+    {"lores~", lores_tilde_setup},
+    {"lowpass~", lowpass_tilde_setup},
+    {"lowshelf~", lowshelf_tilde_setup},
+    {"match", match_setup},
+    {"match~", match_tilde_setup},
+    {"matrix~", matrix_tilde_setup},
+    {"maximum", maximum_setup},
+    {"maximum~", maximum_tilde_setup},
+    {"mean", mean_setup},
+    {"median~", median_tilde_setup},
+    {"merge", merge_setup},
+    {"merge-inlet", merge_setup},
+    {"metronome", metronome_setup},
+    {"midiflush", midiflush_setup},
+    {"midiformat", midiformat_setup},
+    {"midiparse", midiparse_setup},
+    {"minimum", minimum_setup},
+    {"minimum~", minimum_tilde_setup},
+    {"minmax~", minmax_tilde_setup},
+    {"modulo~", modulo_tilde_setup},
+    {"mouse", mouse_setup},
+    {"mousestate", mousestate_setup},
+    {"mov.avg~", setup_mov0x2eavg_tilde},
+    {"mov.rms~", setup_mov0x2erms_tilde},
+    {"mstosamps~", mstosamps_tilde_setup},
+    {"mtx~", mtx_tilde_setup},
+    {"next", next_setup},
+    {"note.in", setup_note0x2ein},
+    {"note.out", setup_note0x2eout},
+    {"notequals~", notequals_tilde_setup},
+    {"nyquist~", nyquist_tilde_setup},
+    {"offer", offer_setup},
+    {"onepole~", onepole_tilde_setup},
+    {"op~", op_tilde_setup},
+    {"overdrive~", overdrive_tilde_setup},
+    {"pack2", pack2_setup},
+    {"pack2-inlet", pack2_setup},
+    {"pak", pak_setup},
+    {"pak-inlet", pak_setup},
+    {"pan2~", pan2_tilde_setup},
+    {"pan4~", pan4_tilde_setup},
+    {"panic", panic_setup},
+    {"parabolic~", parabolic_tilde_setup},
+    {"past", past_setup},
+    {"peak", peak_setup},
+    {"peakamp~", peakamp_tilde_setup},
+    {"peak~", peak_tilde_setup},
+    {"peek~", peek_tilde_setup},
+    {"pgm.in", setup_pgm0x2ein},
+    {"pgm.out", setup_pgm0x2eout},
+    {"phaseshift~", phaseshift_tilde_setup},
+    {"phasewrap~", phasewrap_tilde_setup},
+    {"pimp~", pimp_tilde_setup},
+    {"pinknoise~", pinknoise_tilde_setup},
+    {"pink~", pink_tilde_setup},
+    {"play~", play_tilde_setup},
+    {"pluck~", pluck_tilde_setup},
+    {"plusequals~", plusequals_tilde_setup},
+    {"pmosc~", pmosc_tilde_setup},
+    {"poke~", poke_tilde_setup},
+    {"poltocar", poltocar_setup},
+    {"poltocar~", poltocar_tilde_setup},
+    {"pong", pong_setup},
+    {"pong~", pong_tilde_setup},
+    {"power~", power_tilde_setup},
+    {"prepend", prepend_setup},
+    {"properties", properties_setup},
+    {"pulsecount~", pulsecount_tilde_setup},
+    {"pulsediv~", pulsediv_tilde_setup},
+    {"pulse~", pulse_tilde_setup},
+    {"quad~", quad_tilde_setup},
+    {"quantizer", quantizer_setup},
+    {"quantizer~", quantizer_tilde_setup},
+    {"rad2hz", rad2hz_setup},
+    {"rad2hz~", rad2hz_tilde_setup},
+    {"rampnoise~", rampnoise_tilde_setup},
+    {"rampsmooth~", rampsmooth_tilde_setup},
+    {"ramp~", ramp_tilde_setup},
+    {"rand.f", setup_rand0x2ef},
+    {"rand.f~", setup_rand0x2ef_tilde},
+    {"rand.i", setup_rand0x2ei},
+    {"rand.i~", setup_rand0x2ei_tilde},
+    {"rand.seq", setup_rand0x2eseq},
+    {"randpulse2~", randpulse2_tilde_setup},
+    {"randpulse~", randpulse_tilde_setup},
+    {"rand~", rand_tilde_setup},
+    {"range~", range_tilde_setup},
+    {"ratio2cents", ratio2cents_setup},
+    {"ratio2cents~", ratio2cents_tilde_setup},
+    {"rdiv", rdiv_setup},
+    {"rdiv~", rdiv_tilde_setup},
+    {"receiver", receiver_setup},
+    {"rescale", rescale_setup},
+    {"rescale~", rescale_tilde_setup},
+    {"resonant2~", resonant2_tilde_setup},
+    {"resonant~", resonant_tilde_setup},
+    {"reson~", reson_tilde_setup},
+    {"rint", rint_setup},
+    {"rint~", rint_tilde_setup},
+    {"rminus", rminus_setup},
+    {"rminus~", rminus_tilde_setup},
+    {"rms~", rms_tilde_setup},
+    {"rotate~", rotate_tilde_setup},
+    {"round", round_setup},
+    {"round~", round_tilde_setup},
+    {"routeall", routeall_setup},
+    {"router", router_setup},
+    {"routetype", routetype_setup},
+    {"s2f~", s2f_tilde_setup},
+    {"sah~", sah_tilde_setup},
+    {"sampstoms~", sampstoms_tilde_setup},
+    {"saw2~", saw2_tilde_setup},
+    {"saw~", saw_tilde_setup},
+    {"scale", scale_setup},
+    {"scale~", scale_tilde_setup},
+    {"schmitt~", schmitt_tilde_setup},
+    {"selector", selector_setup},
+    {"selector~", selector_tilde_setup},
+    {"separate", separate_setup},
+    {"sequencer~", sequencer_tilde_setup},
+    {"shaper~", shaper_tilde_setup},
+    {"sh~", sh_tilde_setup},
+    {"sig2float~", sig2float_tilde_setup},
+    {"sine~", sine_tilde_setup},
+    {"sinh", sinh_setup},
+    {"sinh~", sinh_tilde_setup},
+    {"sinx~", sinx_tilde_setup},
+    {"sin~", sin_tilde_setup},
+    {"slice", slice_setup},
+    {"slide~", slide_tilde_setup},
+    {"sort", sort_setup},
+    {"speedlim", speedlim_setup},
+    {"spell", spell_setup},
+    {"spike~", spike_tilde_setup},
+    {"split", split_setup},
+    {"spray", spray_setup},
+    {"spread", spread_setup},
+    {"spread~", spread_tilde_setup},
+    {"sprintf", sprintf_setup},
+    {"square~", square_tilde_setup},
+    {"sr~", sr_tilde_setup},
+    {"standard~", standard_tilde_setup},
+    {"status~", status_tilde_setup},
+    {"stepnoise~", stepnoise_tilde_setup},
+    {"store", store_setup},
+    {"substitute", substitute_setup},
+    {"susloop~", susloop_tilde_setup},
+    {"suspedal", suspedal_setup},
+    {"sustain", sustain_setup},
+    {"svfilter~", svfilter_tilde_setup},
+    {"svf~", svf_tilde_setup},
+    {"switch", switch_setup},
+    {"symbol2any", symbol2any_setup},
+    {"t2", t2_setup},
+    {"table~", table_tilde_setup},
+    {"tabplayer~", tabplayer_tilde_setup},
+    {"tabwriter~", tabwriter_tilde_setup},
+    {"tanh", tanh_setup},
+    {"tanh~", tanh_tilde_setup},
+    {"tanx~", tanx_tilde_setup},
+    {"teeth~", teeth_tilde_setup},
+    {"tempo~", tempo_tilde_setup},
+    {"thresh", thresh_setup},
+    {"thresh~", thresh_tilde_setup},
+    {"timed.gate~", setup_timed0x2egate_tilde},
+    {"togedge", togedge_setup},
+    {"toggleff~", toggleff_tilde_setup},
+    {"tosymbol", tosymbol_setup},
+    {"touch.in", setup_touch0x2ein},
+    {"touch.out", setup_touch0x2eout},
+    {"train~", train_tilde_setup},
+    {"trapezoid~", trapezoid_tilde_setup},
+    {"triangle~", triangle_tilde_setup},
+    {"trig.delay2~", setup_trig0x2edelay2_tilde},
+    {"trig.delay~", setup_trig0x2edelay_tilde},
+    {"trigger2", trigger2_setup},
+    {"trighold~", trighold_tilde_setup},
+    {"tri~", tri_tilde_setup},
+    {"trough", trough_setup},
+    {"typeroute~", typeroute_tilde_setup},
+    {"universal", universal_setup},
+    {"unjoin", unjoin_setup},
+    {"unmerge", unmerge_setup},
+    {"urn", urn_setup},
+    {"uzi", uzi_setup},
+    {"vectral~", vectral_tilde_setup},
+    {"voices", voices_setup},
+    {"vsaw~", vsaw_tilde_setup},
+    {"vu~", vu_tilde_setup},
+    {"wavetable~", wavetable_tilde_setup},
+    {"wave~", wave_tilde_setup},
+    {"wrap2", wrap2_setup},
+    {"wrap2~", wrap2_tilde_setup},
+    {"wt~", wt_tilde_setup},
+    {"xbendin", xbendin_setup},
+    {"xbendin2", xbendin2_setup},
+    {"xbendout", xbendout_setup},
+    {"xbendout2", xbendout2_setup},
+    {"xfade~", xfade_tilde_setup},
+    {"xgate2~", xgate2_tilde_setup},
+    {"xgate~", xgate_tilde_setup},
+    {"xmod2~", xmod2_tilde_setup},
+    {"xmod~", xmod_tilde_setup},
+    {"xnotein", xnotein_setup},
+    {"xnoteout", xnoteout_setup},
+    {"xselect2~", xselect2_tilde_setup},
+    {"xselect~", xselect_tilde_setup},
+    {"zerocross~", zerocross_tilde_setup},
+    {"zerox~", zerox_tilde_setup},
+    {"zl", zl_setup},
+};
+
+#define LIBPD_MULTI_NUMLAZY (sizeof(libpd_multi_lazy_classes) / sizeof(*libpd_multi_lazy_classes))
+
+// set once a class is set up, read without a lock by every instance
+static char libpd_multi_lazy_done[LIBPD_MULTI_NUMLAZY];
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LIBPD_MULTI_LAZY_ISDONE(index) (_InterlockedOr8(&libpd_multi_lazy_done[index], 0) != 0)
+#define LIBPD_MULTI_LAZY_SETDONE(index) _InterlockedExchange8(&libpd_multi_lazy_done[index], 1)
+#else
+#define LIBPD_MULTI_LAZY_ISDONE(index) (__atomic_load_n(&libpd_multi_lazy_done[index], __ATOMIC_ACQUIRE) != 0)
+#define LIBPD_MULTI_LAZY_SETDONE(index) __atomic_store_n(&libpd_multi_lazy_done[index], 1, __ATOMIC_RELEASE)
+#endif
+
+static double libpd_multi_init_time = 0;
+static double libpd_multi_setup_time = 0;
+
+static int libpd_multi_lazy_compare(const void* key, const void* entry)
+{
+    return strcmp((const char*)key, ((const t_libpd_multi_lazyclass*)entry)->l_name);
+}
+
+static const t_libpd_multi_lazyclass* libpd_multi_lazy_find(const char* name)
+{
+    return (const t_libpd_multi_lazyclass*)bsearch(name, libpd_multi_lazy_classes, LIBPD_MULTI_NUMLAZY, sizeof(t_libpd_multi_lazyclass), libpd_multi_lazy_compare);
+}
+
+// names with a library prefix like "cyclone/accum" fall back to the class name
+static const t_libpd_multi_lazyclass* libpd_multi_lazy_find_prefixed(const char* name)
+{
+    const t_libpd_multi_lazyclass* lazy = libpd_multi_lazy_find(name);
+    const char* slash = strrchr(name, '/');
+
+    if(!lazy && slash)
+    {
+        lazy = libpd_multi_lazy_find(slash + 1);
+    }
+    return lazy;
+}
+
+// runs the setup of a class once for the whole process
+// class_new grows pd's global class tables, which every instance reads, so the setup runs under the global lock
+static void libpd_multi_lazy_setup(const t_libpd_multi_lazyclass* lazy)
+{
+    size_t i, index = lazy - libpd_multi_lazy_classes;
+    int verbose;
+
+    if(LIBPD_MULTI_LAZY_ISDONE(index))
+    {
+        return;
+    }
+
+    pd_globallock();
+
+    // another instance may have set it up while we waited for the lock
+    if(!LIBPD_MULTI_LAZY_ISDONE(index))
+    {
+        // the real creators replace the ones we registered, pd reports that when verbose
+        verbose = sys_verbose;
+        sys_verbose = 0;
+        lazy->l_setup();
+        sys_verbose = verbose;
+
+        // a setup function registers all of its names at once
+        for(i = 0; i < LIBPD_MULTI_NUMLAZY; i++)
+        {
+            if(libpd_multi_lazy_classes[i].l_setup == lazy->l_setup)
+            {
+                LIBPD_MULTI_LAZY_SETDONE(i);
+            }
+        }
+    }
+
+    pd_globalunlock();
+}
+
+// registered for every lazy name at startup, so lazy names take precedence over abstractions just like
+// classes that are set up right away, the setup replaces it with the real creator
+static void* libpd_multi_lazy_new(t_symbol* s, int argc, t_atom* argv)
+{
+    const t_libpd_multi_lazyclass* lazy = libpd_multi_lazy_find_prefixed(s->s_name);
+    t_symbol* name;
+
+    if(!lazy)
+    {
+        return 0;
+    }
+
+    libpd_multi_lazy_setup(lazy);
+
+    // prefixed names keep forwarding to the class name
+    name = gensym(lazy->l_name);
+    if(zgetfn(&pd_objectmaker, name) == (t_gotfn)libpd_multi_lazy_new)
+    {
+        pd_error(0, "%s: set up doesn't register this name", lazy->l_name);
+        return 0;
+    }
+
+    typedmess(&pd_objectmaker, name, argc, argv);
+    return pd_newest();
+}
+
+// called by pd when an object can't be created, the path is ignored since these classes are built in
+// bare names never get here, a prefixed name gets a creator that forwards to the class name
+static int libpd_multi_lazy_loader(t_canvas* canvas, const char* classname, const char* path)
+{
+    if(!strchr(classname, '/') || !libpd_multi_lazy_find_prefixed(classname))
+    {
+        return 0;
+    }
+
+    pd_globallock();
+    class_addcreator((t_newmethod)libpd_multi_lazy_new, gensym(classname), A_GIMME, 0);
+    pd_globalunlock();
+
+    return 1;
+}
+
+static void libpd_multi_lazy_init(void)
+{
+    size_t i;
+    for(i = 0; i < LIBPD_MULTI_NUMLAZY; i++)
+    {
+        class_addcreator((t_newmethod)libpd_multi_lazy_new, gensym(libpd_multi_lazy_classes[i].l_name), A_GIMME, 0);
+    }
+    sys_register_loader(libpd_multi_lazy_loader);
+}
+
+void libpd_multi_get_init_times(double* init_time, double* setup_time)
+{
+    *init_time = libpd_multi_init_time;
+    *setup_time = libpd_multi_setup_time;
+}
+
 void libpd_multi_init(void)
 {
     static int initialized = 0;
@@ -741,6 +1448,8 @@ void libpd_multi_init(void)
         libpd_set_midibytehook(libpd_multi_midibyte);
         libpd_set_printhook(libpd_multi_print);
 
+        double starttime = sys_getrealtime();
+
         libpd_set_verbose(0);
         libpd_init();
         
@@ -751,449 +1460,58 @@ void libpd_multi_init(void)
         libpd_set_verbose(4);
 
         socket_init();
-        
+
+        libpd_multi_init_time = sys_getrealtime() - starttime;
+        starttime = sys_getrealtime();
+
+        // Most cyclone and ELSE classes are set up on first use by libpd_multi_lazy_new
+        // The ones below stay eager: they set up several classes or helpers at once,
+        // register names that can't be looked up by class name, or replace a vanilla class
+        libpd_multi_lazy_init();
+
         // cyclone objects
         cyclone_setup();
-        accum_setup();
-        acos_setup();
-        acosh_setup();
         active_setup();
-        anal_setup();
-        append_setup();
-        asin_setup();
-        asinh_setup();
-        atanh_setup();
-        atodb_setup();
-        bangbang_setup();
-        bondo_setup();
-        borax_setup();
-        bucket_setup();
-        buddy_setup();
         capture_setup();
-        cartopol_setup();
-        clip_setup();
         coll_setup();
-        cosh_setup();
-        counter_setup();
-        cycle_setup();
-        dbtoa_setup();
-        decide_setup();
-        decode_setup();
-        drunk_setup();
-        flush_setup();
-        forward_setup();
-        fromsymbol_setup();
-        funnel_setup();
-        gate_setup();
         grab_setup();
-        histo_setup();
-        iter_setup();
-        join_setup();
-        linedrive_setup();
-        listfunnel_setup();
-        loadmess_setup();
-        match_setup();
-        maximum_setup();
-        mean_setup();
-        midiflush_setup();
-        midiformat_setup();
-        midiparse_setup();
-        minimum_setup();
         mousefilter_setup();
-        mousestate_setup();
-        next_setup();
-        offer_setup();
         onebang_setup();
-        pak_setup();
-        past_setup();
-        peak_setup();
-        poltocar_setup();
-        pong_setup();
-        prepend_setup();
         prob_setup();
         pv_setup();
-        rdiv_setup();
-        rminus_setup();
-        round_setup();
-        scale_setup();
         seq_setup();
-        sinh_setup();
-        speedlim_setup();
-        spell_setup();
-        split_setup();
-        spray_setup();
-        sprintf_setup();
-        substitute_setup();
-        sustain_setup();
-        switch_setup();
         table_setup();
-        tanh_setup();
-        thresh_setup();
-        togedge_setup();
-        tosymbol_setup();
-        trough_setup();
-        universal_setup();
-        unjoin_setup();
-        urn_setup();
-        uzi_setup();
-        xbendin_setup();
-        xbendin2_setup();
-        xbendout_setup();
-        xbendout2_setup();
-        xnotein_setup();
-        xnoteout_setup();
-        zl_setup();
         
-        acos_tilde_setup();
-        acosh_tilde_setup();
-        allpass_tilde_setup();
-        asin_tilde_setup();
-        asinh_tilde_setup();
-        atan_tilde_setup();
-        atan2_tilde_setup();
-        atanh_tilde_setup();
-        atodb_tilde_setup();
-        average_tilde_setup();
-        avg_tilde_setup();
-        bitand_tilde_setup();
-        bitnot_tilde_setup();
-        bitor_tilde_setup();
-        bitsafe_tilde_setup();
-        bitshift_tilde_setup();
-        bitxor_tilde_setup();
-        buffir_tilde_setup();
         capture_tilde_setup();
-        cartopol_tilde_setup();
-        change_tilde_setup();
-        click_tilde_setup();
-        clip_tilde_setup();
-        comb_tilde_setup();
-        cosh_tilde_setup();
-        cosx_tilde_setup();
-        count_tilde_setup();
-        cross_tilde_setup();
-        curve_tilde_setup();
-        cycle_tilde_setup();
-        dbtoa_tilde_setup();
-        degrade_tilde_setup();
-        delay_tilde_setup();
-        delta_tilde_setup();
-        deltaclip_tilde_setup();
-        downsamp_tilde_setup();
-        edge_tilde_setup();
-        equals_tilde_setup();
-        frameaccum_tilde_setup();
-        framedelta_tilde_setup();
-        gate_tilde_setup();
-        greaterthan_tilde_setup();
-        greaterthaneq_tilde_setup();
-        index_tilde_setup();
-        kink_tilde_setup();
-        lessthan_tilde_setup();
-        lessthaneq_tilde_setup();
-        line_tilde_setup();
-        lookup_tilde_setup();
-        lores_tilde_setup();
-        matrix_tilde_setup();
-        maximum_tilde_setup();
-        minimum_tilde_setup();
-        minmax_tilde_setup();
-        modulo_tilde_setup();
-        mstosamps_tilde_setup();
-        notequals_tilde_setup();
-        onepole_tilde_setup();
-        overdrive_tilde_setup();
-        peakamp_tilde_setup();
-        peek_tilde_setup();
-        phaseshift_tilde_setup();
-        phasewrap_tilde_setup();
-        pink_tilde_setup();
-        play_tilde_setup();
-        plusequals_tilde_setup();
-        poke_tilde_setup();
-        poltocar_tilde_setup();
-        pong_tilde_setup();
-        pow_tilde_setup();
-        rampsmooth_tilde_setup();
-        rand_tilde_setup();
-        rdiv_tilde_setup();
         record_tilde_setup();
-        reson_tilde_setup();
-        rminus_tilde_setup();
-        round_tilde_setup();
-        sah_tilde_setup();
-        sampstoms_tilde_setup();
-        scale_tilde_setup();
         scope_tilde_setup();
-        selector_tilde_setup();
-        sinh_tilde_setup();
-        sinx_tilde_setup();
-        slide_tilde_setup();
-        snapshot_tilde_setup();
-        spike_tilde_setup();
-        svf_tilde_setup();
-        tanh_tilde_setup();
-        tanx_tilde_setup();
-        teeth_tilde_setup();
-        thresh_tilde_setup();
-        train_tilde_setup();
-        trapezoid_tilde_setup();
-        triangle_tilde_setup();
         trunc_tilde_setup();
-        typeroute_tilde_setup();
-        vectral_tilde_setup();
-        wave_tilde_setup();
-        zerox_tilde_setup();
 
         // else objects initialization
-        above_tilde_setup();
-        add_tilde_setup();
-        adsr_tilde_setup();
-        setup_allpass0x2e2nd_tilde();
-        setup_allpass0x2erev_tilde();
-        args_setup();
-        asr_tilde_setup();
-        autofade_tilde_setup();
-        autofade2_tilde_setup();
-        balance_tilde_setup();
-        bandpass_tilde_setup();
-        bandstop_tilde_setup();
-        setup_bend0x2ein();
-        setup_bend0x2eout();
-        bicoeff_setup();
-        biquads_tilde_setup();
-        blocksize_tilde_setup();
-        break_setup();
-        brown_tilde_setup();
-        buffer_setup();
         button_setup();
         setup_canvas0x2eactive();
         setup_canvas0x2ebounds();
-        setup_canvas0x2egop();
         setup_canvas0x2eedit();
         setup_canvas0x2emouse();
-        setup_canvas0x2ename();
-        setup_canvas0x2epos();
-        setup_canvas0x2esetname();
         setup_canvas0x2evis();
-        setup_canvas0x2ewname();
         setup_canvas0x2ezoom();
-        ceil_setup();
-        ceil_tilde_setup();
-        cents2ratio_setup();
-        cents2ratio_tilde_setup();
-        chance_setup();
-        chance_tilde_setup();
-        changed_setup();
-        changed_tilde_setup();
-        changed2_tilde_setup();
-        click_setup();
-        clipnoise_tilde_setup();
-        cmul_tilde_setup();
-        coin_setup();
-        coin_tilde_setup();
         colors_setup();
-        setup_comb0x2efilt_tilde();
-        setup_comb0x2erev_tilde();
-        setup_common0x2ediv();
-        cosine_tilde_setup();
-        crackle_tilde_setup();
-        crossover_tilde_setup();
-        setup_ctl0x2ein();
-        setup_ctl0x2eout();
-        cusp_tilde_setup();
-        decay_tilde_setup();
-        decay2_tilde_setup();
-        del_tilde_setup();
-        detect_tilde_setup();
-        dollsym_setup();
-        downsample_tilde_setup();
-        drive_tilde_setup();
-        dust_tilde_setup();
-        dust2_tilde_setup();
         else_setup();
-        envgen_tilde_setup();
-        eq_tilde_setup();
-        f2s_tilde_setup();
-        factor_setup();
-        fader_tilde_setup();
-        fbdelay_tilde_setup();
-        fbsine_tilde_setup();
-        fbsine2_tilde_setup();
-        setup_fdn0x2erev_tilde();
-        ffdelay_tilde_setup();
-        float2bits_setup();
-        float2sig_tilde_setup();
-        floor_setup();
-        floor_tilde_setup();
-        fold_setup();
-        fold_tilde_setup();
         fontsize_setup();
-        format_setup();
-        setup_freq0x2eshift_tilde();
         function_setup();
-        function_tilde_setup();
-        gate2imp_tilde_setup();
-        gbman_tilde_setup();
-        gcd_setup();
-        setup_giga0x2erev_tilde();
-        glide_tilde_setup();
-        glide2_tilde_setup();
-        gray_tilde_setup();
-        gui_setup();
-        henon_tilde_setup();
-        highpass_tilde_setup();
-        highshelf_tilde_setup();
-        hot_setup();
-        hz2rad_setup();
-        hz2rad_tilde_setup();
-        ikeda_tilde_setup();
-        imp_tilde_setup();
-        imp2_tilde_setup();
-        impulse_tilde_setup();
-        impulse2_tilde_setup();
-        initmess_setup();
-        int_tilde_setup();
         keyboard_setup();
-        lag_tilde_setup();
-        lag2_tilde_setup();
-        lastvalue_tilde_setup();
-        latoocarfian_tilde_setup();
-        lb_setup();
-        lfnoise_tilde_setup();
-        limit_setup();
-        lincong_tilde_setup();
-        loadbanger_setup();
-        logistic_tilde_setup();
-        loop_setup();
-        lorenz_tilde_setup();
-        lowpass_tilde_setup();
-        lowshelf_tilde_setup();
-        match_tilde_setup();
-        median_tilde_setup();
-        merge_setup();
-        metronome_setup();
         message_setup();
         messbox_setup();
         midi_setup();
-        mouse_setup();
-        setup_mov0x2eavg_tilde();
-        setup_mov0x2erms_tilde();
-        mtx_tilde_setup();
         nbang_setup();
         note_setup();
-        setup_note0x2ein();
-        setup_note0x2eout();
-        nyquist_tilde_setup();
-        op_tilde_setup();
         openfile_setup();
         //oscilloscope_tilde_setup();
-        pack2_setup();
         pad_setup();
-        pan2_tilde_setup();
-        pan4_tilde_setup();
-        panic_setup();
-        parabolic_tilde_setup();
-        peak_tilde_setup();
-        setup_pgm0x2ein();
-        setup_pgm0x2eout();
-        pimp_tilde_setup();
-        pinknoise_tilde_setup();
-        pluck_tilde_setup();
-        pmosc_tilde_setup();
-        power_tilde_setup();
-        properties_setup();
-        pulse_tilde_setup();
-        pulsecount_tilde_setup();
-        pulsediv_tilde_setup();
-        quad_tilde_setup();
-        quantizer_setup();
-        quantizer_tilde_setup();
-        rad2hz_setup();
-        rad2hz_tilde_setup();
-        ramp_tilde_setup();
-        rampnoise_tilde_setup();
-        setup_rand0x2ef();
-        setup_rand0x2ef_tilde();
-        setup_rand0x2ei();
-        setup_rand0x2ei_tilde();
-        setup_rand0x2eseq();
-        randpulse_tilde_setup();
-        randpulse2_tilde_setup();
-        range_tilde_setup();
-        ratio2cents_setup();
-        ratio2cents_tilde_setup();
-        receiver_setup();
-        rescale_setup();
-        rescale_tilde_setup();
-        resonant_tilde_setup();
-        resonant2_tilde_setup();
         retrieve_setup();
-        rint_tilde_setup();
-        rint_setup();
-        rms_tilde_setup();
-        rotate_tilde_setup();
-        routeall_setup();
-        router_setup();
-        routetype_setup();
-        s2f_tilde_setup();
-        saw_tilde_setup();
-        saw2_tilde_setup();
-        schmitt_tilde_setup();
-        selector_setup();
-        separate_setup();
-        sequencer_tilde_setup();
-        sh_tilde_setup();
-        shaper_tilde_setup();
-        sig2float_tilde_setup();
-        sin_tilde_setup();
-        sine_tilde_setup();
-        slice_setup();
-        sort_setup();
-        spread_setup();
-        spread_tilde_setup();
-        square_tilde_setup();
-        sr_tilde_setup();
-        standard_tilde_setup();
-        status_tilde_setup();
-        stepnoise_tilde_setup();
-        store_setup();
-        susloop_tilde_setup();
-        suspedal_setup();
-        svfilter_tilde_setup();
-        symbol2any_setup();
-        t2_setup();
-        table_tilde_setup();
-        tabplayer_tilde_setup();
-        tabwriter_tilde_setup();
-        tempo_tilde_setup();
-        setup_timed0x2egate_tilde();
-        toggleff_tilde_setup();
-        setup_touch0x2ein();
-        setup_touch0x2eout();
-        tri_tilde_setup();
-        setup_trig0x2edelay_tilde();
-        setup_trig0x2edelay2_tilde();
-        trigger2_setup();
-        trighold_tilde_setup();
-        unmerge_setup();
-        voices_setup();
-        vsaw_tilde_setup();
-        vu_tilde_setup();
-        wavetable_tilde_setup();
-        wrap2_setup();
-        wrap2_tilde_setup();
-        wt_tilde_setup();
-        xfade_tilde_setup();
-        xgate_tilde_setup();
-        xgate2_tilde_setup();
-        xmod_tilde_setup();
-        xmod2_tilde_setup();
-        xselect_tilde_setup();
-        xselect2_tilde_setup();
-        zerocross_tilde_setup();
         // end else objects initialization
-        
+
+        libpd_multi_setup_time = sys_getrealtime() - starttime;
 
         initialized = 1;
     }
@@ -15,11 +15,15 @@ extern "C"
 
 void libpd_multi_init(void);
 
-typedef void (*t_libpd_multi_banghook)(void* ptr, const char *recv);
-typedef void (*t_libpd_multi_floathook)(void* ptr, const char *recv, float f);
-typedef void (*t_libpd_multi_symbolhook)(void* ptr, const char *recv, const char *s);
-typedef void (*t_libpd_multi_listhook)(void* ptr, const char *recv, int argc, t_atom *argv);
-typedef void (*t_libpd_multi_messagehook)(void* ptr, const char *recv, const char *msg, int argc, t_atom *argv);
+// time spent in libpd_init and in setting up the eager classes, in seconds
+void libpd_multi_get_init_times(double* init_time, double* setup_time);
+
+// receivers pass their interned symbols, so the hooks don't need to look them up again
+typedef void (*t_libpd_multi_banghook)(void* ptr, t_symbol *recv);
+typedef void (*t_libpd_multi_floathook)(void* ptr, t_symbol *recv, float f);
+typedef void (*t_libpd_multi_symbolhook)(void* ptr, t_symbol *recv, t_symbol *s);
+typedef void (*t_libpd_multi_listhook)(void* ptr, t_symbol *recv, int argc, t_atom *argv);
+typedef void (*t_libpd_multi_messagehook)(void* ptr, t_symbol *recv, t_symbol *msg, int argc, t_atom *argv);
 
 void* libpd_multi_receiver_new(void* ptr, char const *s,
                                t_libpd_multi_banghook hook_bang,
@@ -46,6 +50,9 @@ void* libpd_multi_midi_new(void* ptr,
                            t_libpd_multi_polyaftertouchhook hook_polyaftertouch,
                            t_libpd_multi_midibytehook hook_midibyte);
 
+// schedules a midi message of up to 3 bytes, offset is in samples from the current logical time
+void libpd_multi_schedule_midi(void* ptr, int port, double offset, int size, const unsigned char* data);
+
 typedef void (*t_libpd_multi_printhook)(void* ptr, const char *recv);
 
 void* libpd_multi_print_new(void* ptr, t_libpd_multi_printhook hook_print);
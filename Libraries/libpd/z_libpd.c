@@ -20,6 +20,7 @@
 #include "z_libpd.h"
 #include "x_libpdreceive.h"
 #include "z_hooks.h"
+#include "s_libpd_inter.h"
 #include "s_stuff.h"
 #include "m_imp.h"
 #include "g_all_guis.h"
@@ -242,6 +243,33 @@ int libpd_process_raw_double(const double *inBuffer, double *outBuffer) {
   PROCESS_RAW(,)
 }
 
+int libpd_process_channels(const int ticks, const float **inBuffer, float **outBuffer) {
+  int n_in = STUFF->st_inchannels;
+  int n_out = STUFF->st_outchannels;
+  const float *in;
+  float *out;
+  t_sample *p;
+  int i, j, k;
+  sys_lock();
+  sys_pollgui();
+  for (i = 0; i < ticks; i++) {
+    for (p = STUFF->st_soundin, j = 0; j < n_in; j++) {
+      for (in = inBuffer[j] + i * DEFDACBLKSIZE, k = 0; k < DEFDACBLKSIZE; k++) {
+        *p++ = *in++;
+      }
+    }
+    memset(STUFF->st_soundout, 0, n_out * DEFDACBLKSIZE * sizeof(t_sample));
+    SCHED_TICK(pd_this->pd_systime + STUFF->st_time_per_dsp_tick);
+    for (p = STUFF->st_soundout, j = 0; j < n_out; j++) {
+      for (out = outBuffer[j] + i * DEFDACBLKSIZE, k = 0; k < DEFDACBLKSIZE; k++) {
+        *out++ = *p++;
+      }
+    }
+  }
+  sys_unlock();
+  return 0;
+}
+
 #define GETARRAY \
   t_garray *garray = (t_garray *) pd_findbyclass(gensym(name), garray_class); \
   if (!garray) {sys_unlock(); return -1;} \
@@ -259,13 +287,15 @@ int libpd_resize_array(const char *name, long size) {
   sys_lock();
   GETARRAY
   garray_resize_long(garray, size);
+  update_array(garray, 0, INT_MAX);
   sys_unlock();
   return 0;
 }
 
 #define MEMCPY(_x, _y) \
   GETARRAY \
-  if (n < 0 || offset < 0 || offset + n > garray_npoints(garray)) return -2; \
+  if (n < 0 || offset < 0 || offset + n > garray_npoints(garray)) { \
+    sys_unlock(); return -2;} \
   t_word *vec = ((t_word *) garray_vec(garray)) + offset; \
   int i; \
   for (i = 0; i < n; i++) _x = _y;
@@ -280,6 +310,7 @@ int libpd_read_array(float *dest, const char *name, int offset, int n) {
 int libpd_write_array(const char *name, int offset, const float *src, int n) {
   sys_lock();
   MEMCPY((vec++)->w_float, *src++)
+  update_array(garray, offset, offset + n);
   sys_unlock();
   return 0;
 }
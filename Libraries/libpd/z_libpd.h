@@ -106,6 +106,15 @@ EXTERN int libpd_process_raw_short(const short *inBuffer, short *outBuffer);
 /// returns 0 on success
 EXTERN int libpd_process_raw_double(const double *inBuffer, double *outBuffer);
 
+/// process non-interleaved float samples for several ticks under a single lock
+/// reads from and writes to one buffer per channel, so host buffers can be passed directly
+/// buffer sizes are based on # of ticks where:
+///     size = ticks * libpd_blocksize() for each of the (in/out)channels
+/// only the current instance is locked, so separate instances can process on separate threads
+/// returns 0 on success
+EXTERN int libpd_process_channels(const int ticks,
+    const float **inBuffer, float **outBuffer);
+
 /* array access */
 
 /// get the size of an array by name
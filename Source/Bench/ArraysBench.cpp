@@ -0,0 +1,115 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Arrays bench: the peak pyramid that arrays are drawn from, at 64, 64k and 16M elements
+// Times rebuilding it, updating it after an edit, and getting one range per pixel column like a paint does,
+// next to reading every element per column, which is what drawing cost before the pyramid
+
+#include "Bench.h"
+
+#include "../Pd/PdArray.h"
+
+namespace
+{
+// Written with the ranges, so they aren't optimised away
+volatile float sink = 0.0f;
+
+// Repeats a measurement until it has taken long enough to be stable
+template<typename Function>
+Timings measure(Function&& function)
+{
+    Timings timings;
+
+    while (timings.size() < 3 || (timings.getTotal() < 0.2 && timings.size() < 10000))
+    {
+        auto start = Time::getHighResolutionTicks();
+        function();
+        timings.add(getSecondsSince(start));
+    }
+
+    return timings;
+}
+
+void runArraySize(size_t size, int width)
+{
+    Random random(0x61727261);
+
+    std::vector<float> data(size);
+    for (auto& value : data) value = random.nextFloat() * 2.0f - 1.0f;
+
+    pd::ArrayPeaks peaks;
+
+    auto rebuild = measure([&]() { peaks.rebuild(data); });
+
+    // An edit, like dragging over the array or a tabwrite~ block
+    size_t const editSize = std::min<size_t>(64, size);
+    auto update = measure(
+        [&]()
+        {
+            auto start = std::min(size - editSize, static_cast<size_t>(random.nextDouble() * static_cast<double>(size - editSize + 1)));
+            data[start] = random.nextFloat();
+            peaks.update(data, start, start + editSize);
+        });
+
+    float sum = 0.0f;
+
+    auto columns = measure(
+        [&]()
+        {
+            for (int x = 0; x < width; x++)
+            {
+                auto const start = size * x / width;
+                auto const end = std::max(start + 1, size * (x + 1) / width);
+                auto const [min, max] = peaks.getRange(data, start, end);
+                sum += min + max;
+            }
+        });
+
+    auto elements = measure(
+        [&]()
+        {
+            for (int x = 0; x < width; x++)
+            {
+                auto const start = size * x / width;
+                auto const end = std::max(start + 1, size * (x + 1) / width);
+                auto const [min, max] = std::minmax_element(data.begin() + start, data.begin() + end);
+                sum += *min + *max;
+            }
+        });
+
+    sink = sum;
+
+    std::cout << size << " elements:\n";
+    std::cout << "  rebuild (us): " << rebuild.getSummary() << "\n";
+    std::cout << "  update of " << editSize << " (us): " << update.getSummary() << "\n";
+    std::cout << "  " << width << " columns from the peaks (us): " << columns.getSummary() << "\n";
+    std::cout << "  " << width << " columns from every element (us): " << elements.getSummary() << std::endl;
+}
+} // namespace
+
+int runArraysBench(ArgumentList const& args)
+{
+    auto size = args.getValueForOption("--size").getLargeIntValue();
+    auto width = args.getValueForOption("--width").getIntValue();
+
+    if (size < 0 || width < 0)
+    {
+        std::cerr << "--size and --width have to be positive" << std::endl;
+        return 1;
+    }
+
+    if (width == 0) width = 1000;
+
+    std::vector<size_t> sizes = {64, 64 * 1024, 16 * 1024 * 1024};
+    if (size > 0) sizes = {static_cast<size_t>(size)};
+
+    for (auto arraySize : sizes)
+    {
+        runArraySize(arraySize, width);
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+#include "Bench.h"
+
+extern "C"
+{
+#include <g_canvas.h>
+#include <m_imp.h>
+#include <z_libpd.h>
+}
+
+// Included last, windows.h declares names that clash with JUCE's
+#if JUCE_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#if JUCE_MSVC
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+int64 getPeakMemoryUsage()
+{
+#if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return static_cast<int64>(counters.PeakWorkingSetSize);
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if JUCE_MAC
+    return static_cast<int64>(usage.ru_maxrss);
+#else
+    return static_cast<int64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void addSearchPaths(pd::Instance& instance)
+{
+    auto appDir = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("PlugData");
+    auto abstractions = appDir.getChildFile("Abstractions");
+
+    if (!appDir.exists() || !abstractions.exists())
+    {
+        appDir.createDirectory();
+
+        MemoryInputStream binaryAbstractions(BinaryData::Abstractions_zip, BinaryData::Abstractions_zipSize, false);
+        auto file = ZipFile(binaryAbstractions);
+        file.uncompressTo(appDir);
+    }
+
+    instance.setThis();
+    libpd_clear_search_path();
+
+    auto settings = ValueTree::fromXml(appDir.getChildFile("Settings.xml").loadFileAsString());
+    auto pathTree = settings.getChildWithName("Paths");
+
+    if (pathTree.getNumChildren() == 0)
+    {
+        libpd_add_to_search_path(abstractions.getFullPathName().toRawUTF8());
+    }
+
+    for (auto child : pathTree)
+    {
+        auto path = child.getProperty("Path").toString();
+        libpd_add_to_search_path(path.toRawUTF8());
+    }
+}
+
+void findBrokenObjects(t_canvas* cnv, StringArray& broken)
+{
+    for (t_gobj* y = cnv->gl_list; y; y = y->g_next)
+    {
+        auto* cls = pd_class(&y->g_pd);
+
+        if (cls == canvas_class)
+        {
+            findBrokenObjects(reinterpret_cast<t_canvas*>(y), broken);
+        }
+        else if (cls == text_class && reinterpret_cast<t_text*>(y)->te_type == T_OBJECT && binbuf_getnatom(reinterpret_cast<t_text*>(y)->te_binbuf) > 0)
+        {
+            char* text = nullptr;
+            int size = 0;
+            binbuf_gettext(reinterpret_cast<t_text*>(y)->te_binbuf, &text, &size);
+            broken.add(String(CharPointer_UTF8(text), static_cast<size_t>(size)));
+            freebytes(text, static_cast<size_t>(size));
+        }
+    }
+}
+
+pd::Patch openPatchFromText(pd::Instance& instance, TemporaryFile& file, String const& text)
+{
+    file.getFile().replaceWithText(text);
+    return instance.openPatch(file.getFile());
+}
@@ -0,0 +1,129 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Shared parts of the plugdata-render bench modes
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../Pd/PdInstance.h"
+
+class BenchInstance : public pd::Instance
+{
+   public:
+    explicit BenchInstance(bool printToConsole) : pd::Instance("PlugDataBench"), verbose(printToConsole)
+    {
+    }
+
+    const CriticalSection* getCallbackLock() override
+    {
+        return &lock;
+    }
+
+    void receivePrint(const std::string& message) override
+    {
+        if (verbose && !message.empty()) std::cerr << message << std::endl;
+    }
+
+   private:
+    CriticalSection lock;
+    bool verbose;
+};
+
+// Durations in seconds, reported as percentiles in microseconds
+class Timings
+{
+   public:
+    void reserve(size_t size)
+    {
+        times.reserve(size);
+    }
+
+    void add(double seconds)
+    {
+        times.push_back(seconds);
+        total += seconds;
+        sorted = false;
+    }
+
+    size_t size() const noexcept
+    {
+        return times.size();
+    }
+
+    double getTotal() const noexcept
+    {
+        return total;
+    }
+
+    double getPercentile(double fraction)
+    {
+        if (times.empty()) return 0.0;
+
+        if (!sorted)
+        {
+            std::sort(times.begin(), times.end());
+            sorted = true;
+        }
+
+        auto index = std::min(times.size() - 1, static_cast<size_t>(fraction * static_cast<double>(times.size())));
+        return times[index] * 1e6;
+    }
+
+    // Standard deviation in microseconds
+    double getDeviation() const
+    {
+        if (times.empty()) return 0.0;
+
+        auto const mean = total / static_cast<double>(times.size());
+
+        double sum = 0.0;
+        for (auto time : times) sum += (time - mean) * (time - mean);
+
+        return std::sqrt(sum / static_cast<double>(times.size())) * 1e6;
+    }
+
+    String getSummary()
+    {
+        return String::formatted("p50 %.2f, p90 %.2f, p99 %.2f, p99.9 %.2f, max %.2f", getPercentile(0.5), getPercentile(0.9), getPercentile(0.99), getPercentile(0.999), getPercentile(1.0));
+    }
+
+   private:
+    std::vector<double> times;
+    double total = 0.0;
+    bool sorted = true;
+};
+
+inline double getSecondsSince(int64 startTicks)
+{
+    return static_cast<double>(Time::getHighResolutionTicks() - startTicks) / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+}
+
+int64 getPeakMemoryUsage();
+
+// Same search paths as the plugin: the bundled abstractions, unzipped on first use, and the paths from the user's settings
+void addSearchPaths(pd::Instance& instance);
+
+// Objects that failed to create stay in the patch as empty boxes of the text class
+void findBrokenObjects(t_canvas* cnv, StringArray& broken);
+
+// Opens a patch written by a bench mode, the file has to outlive the patch
+pd::Patch openPatchFromText(pd::Instance& instance, TemporaryFile& file, String const& text);
+
+// Bench modes, selected with --bench <mode>
+int runQueueBench(ArgumentList const& args);
+int runMidiBench(ArgumentList const& args);
+int runInstancesBench(ArgumentList const& args);
+int runArraysBench(ArgumentList const& args);
+int runRoutingBench(ArgumentList const& args);
+int runStartupBench(ArgumentList const& args);
+int runNetworkBench(ArgumentList const& args);
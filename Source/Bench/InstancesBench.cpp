@@ -0,0 +1,172 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Instance scaling bench: many pd instances, like plugin instances in a host project, ticked from 1 up to N threads
+// Instances only share pd's class list, so the time per thread count shows how much of that still serializes them
+
+#include "Bench.h"
+
+#include <cmath>
+
+namespace
+{
+// Oscillators through a few filters into the dac, enough dsp per tick that the locking is not all that's measured
+String createInstancesPatch(int numChains)
+{
+    String patch = "#N canvas 0 0 400 300 12;\n";
+
+    for (int i = 0; i < numChains; i++)
+    {
+        patch << "#X obj 10 10 osc~ " << String(100 + i * 7) << ";\n";
+        patch << "#X obj 10 40 lop~ 2000;\n";
+        patch << "#X obj 10 70 hip~ 50;\n";
+        patch << "#X obj 10 100 *~ 0.01;\n";
+    }
+
+    int const dac = numChains * 4;
+    patch << "#X obj 10 130 dac~;\n";
+
+    for (int i = 0; i < numChains; i++)
+    {
+        int const first = i * 4;
+        patch << "#X connect " << String(first) << " 0 " << String(first + 1) << " 0;\n";
+        patch << "#X connect " << String(first + 1) << " 0 " << String(first + 2) << " 0;\n";
+        patch << "#X connect " << String(first + 2) << " 0 " << String(first + 3) << " 0;\n";
+        patch << "#X connect " << String(first + 3) << " 0 " << String(dac) << " 0;\n";
+        patch << "#X connect " << String(first + 3) << " 0 " << String(dac) << " 1;\n";
+    }
+
+    return patch;
+}
+
+// Ticks its share of the instances in turn, the way a host thread runs the plugins assigned to it
+class RenderThread : public Thread
+{
+   public:
+    RenderThread(int64 ticks, int size) : Thread("Instances Bench Render"), numTicks(ticks), blockSize(size)
+    {
+    }
+
+    void run() override
+    {
+        std::vector<float> inputBuffer;
+        std::vector<float> outputBuffer(static_cast<size_t>(2 * blockSize), 0.0f);
+
+        for (int64 tick = 0; tick < numTicks; tick++)
+        {
+            for (auto* instance : instances)
+            {
+                instance->sendMessagesFromQueue();
+                instance->performDSP(inputBuffer.data(), outputBuffer.data());
+                instance->sendMessagesFromQueue();
+            }
+        }
+    }
+
+    std::vector<pd::Instance*> instances;
+
+   private:
+    int64 numTicks;
+    int blockSize;
+};
+} // namespace
+
+int runInstancesBench(ArgumentList const& args)
+{
+    auto getOption = [&args](const String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    };
+
+    auto seconds = getOption("--seconds", 2.0);
+    auto sampleRate = getOption("--samplerate", 48000.0);
+    auto numInstances = static_cast<int>(getOption("--instances", 16));
+    auto numChains = static_cast<int>(getOption("--chains", 64));
+    auto patchPath = args.getValueForOption("--patch");
+
+    if (seconds <= 0 || sampleRate <= 0 || numInstances <= 0 || numChains <= 0)
+    {
+        std::cerr << "--seconds, --samplerate, --instances and --chains have to be positive" << std::endl;
+        return 1;
+    }
+
+    TemporaryFile patchFile(".pd");
+    auto file = patchFile.getFile();
+
+    if (patchPath.isNotEmpty())
+    {
+        file = File::getCurrentWorkingDirectory().getChildFile(patchPath);
+        if (!file.existsAsFile())
+        {
+            std::cerr << "Patch not found: " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        file.replaceWithText(createInstancesPatch(numChains));
+    }
+
+    std::vector<std::unique_ptr<BenchInstance>> instances;
+
+    for (int i = 0; i < numInstances; i++)
+    {
+        auto* instance = instances.emplace_back(std::make_unique<BenchInstance>(false)).get();
+        instance->prepareDSP(0, 2, sampleRate);
+        addSearchPaths(*instance);
+
+        if (!instance->openPatch(file).getPointer())
+        {
+            std::cerr << "Failed to open patch: " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        instance->startDSP();
+        instance->sendMessagesFromQueue();
+    }
+
+    int const blockSize = instances.front()->getBlockSize();
+    auto const numTicks = static_cast<int64>(std::ceil(seconds * sampleRate / blockSize));
+    auto const renderedSeconds = static_cast<double>(numTicks * blockSize) / sampleRate * numInstances;
+
+    // Powers of two up to the number of instances, and the number of instances itself
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < numInstances; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(numInstances);
+
+    std::cout << String::formatted("%d instances, %.2f s each at %.0f Hz", numInstances, seconds, sampleRate) << "\n";
+
+    double singleThreadTime = 0.0;
+
+    for (auto numThreads : threadCounts)
+    {
+        std::vector<std::unique_ptr<RenderThread>> threads;
+        for (int i = 0; i < numThreads; i++) threads.push_back(std::make_unique<RenderThread>(numTicks, blockSize));
+
+        for (int i = 0; i < numInstances; i++) threads[i % numThreads]->instances.push_back(instances[i].get());
+
+        auto start = Time::getHighResolutionTicks();
+
+        for (auto& thread : threads) thread->startThread();
+        for (auto& thread : threads) thread->waitForThreadToExit(-1);
+
+        auto elapsed = getSecondsSince(start);
+        if (numThreads == 1) singleThreadTime = elapsed;
+
+        auto speedup = elapsed > 0.0 ? singleThreadTime / elapsed : 0.0;
+
+        std::cout << String::formatted("%3d thread(s): %.3f s, %.1fx realtime, %.2fx speedup, %.0f%% efficiency", numThreads, elapsed, renderedSeconds / elapsed, speedup, speedup / numThreads * 100.0) << std::endl;
+    }
+
+    for (auto& instance : instances)
+    {
+        instance->releaseDSP();
+        instance->closePatch();
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Midi jitter bench: note ons at known sample positions go through [notein] -> [noteout] at large host buffers,
+// the same way the processor schedules them, and come back with the offset they were stamped with
+// Without sub-tick scheduling every note lands on the start of its tick or buffer, so the error shows up here
+
+#include "Bench.h"
+
+#include <cmath>
+#include <deque>
+
+namespace
+{
+char const* midiPatch =
+    "#N canvas 0 0 400 300 12;\n"
+    "#X obj 10 10 notein;\n"
+    "#X obj 10 60 noteout;\n"
+    "#X connect 0 0 1 0;\n"
+    "#X connect 0 1 1 1;\n"
+    "#X connect 0 2 1 2;\n";
+
+class MidiInstance : public BenchInstance
+{
+   public:
+    MidiInstance() : BenchInstance(false)
+    {
+    }
+
+    // Notes come back in the order they were scheduled, so each one is matched with the oldest expected position
+    void receiveNoteOn(const int channel, const int pitch, const int velocity) override
+    {
+        if (expected.empty())
+        {
+            unexpected++;
+            return;
+        }
+
+        errors.push_back(std::abs(getMidiOffset() - expected.front()));
+        expected.pop_front();
+    }
+
+    std::deque<int> expected;
+    std::vector<int> errors;
+    int unexpected = 0;
+};
+
+void runMidiBufferSize(int bufferSize, double seconds, double sampleRate, int notesPerBuffer)
+{
+    MidiInstance instance;
+    instance.prepareDSP(0, 2, sampleRate);
+
+    TemporaryFile patchFile(".pd");
+    auto patch = openPatchFromText(instance, patchFile, midiPatch);
+    if (!patch.getPointer())
+    {
+        std::cerr << "Failed to open the midi bench patch" << std::endl;
+        return;
+    }
+
+    instance.startDSP();
+    instance.sendMessagesFromQueue();
+
+    int const blockSize = instance.getBlockSize();
+    int const numTicks = bufferSize / blockSize;
+    auto const numBuffers = static_cast<int64>(std::ceil(seconds * sampleRate / bufferSize));
+
+    std::vector<float> outputBuffer(static_cast<size_t>(2 * bufferSize), 0.0f);
+    std::vector<float*> outputs = {outputBuffer.data(), outputBuffer.data() + bufferSize};
+    std::vector<const float*> inputs;
+
+    // Same seed for every buffer size, so runs can be compared
+    Random random(0x6d696469);
+    std::vector<int> positions(static_cast<size_t>(notesPerBuffer));
+    int64 scheduled = 0;
+
+    for (int64 buffer = 0; buffer < numBuffers; buffer++)
+    {
+        for (auto& position : positions) position = random.nextInt(bufferSize);
+        std::sort(positions.begin(), positions.end());
+
+        // Same order as the processor's block: time reference, scheduled midi, all ticks, then the output
+        instance.setMidiTimeReference(bufferSize);
+
+        for (auto position : positions)
+        {
+            auto const pitch = static_cast<uint8>(36 + position % 48);
+            uint8 const noteOn[3] = {0x90, pitch, 100};
+
+            instance.scheduleMidiMessage(position, noteOn, 3);
+            instance.expected.push_back(position);
+        }
+
+        scheduled += notesPerBuffer;
+
+        instance.performDSP(inputs.data(), outputs.data(), numTicks);
+        instance.sendMessagesFromQueue();
+    }
+
+    instance.releaseDSP();
+    instance.closePatch();
+
+    auto& errors = instance.errors;
+    std::sort(errors.begin(), errors.end());
+
+    auto percentile = [&errors](double fraction)
+    {
+        if (errors.empty()) return 0;
+        return errors[std::min(errors.size() - 1, static_cast<size_t>(fraction * static_cast<double>(errors.size())))];
+    };
+
+    auto const exact = std::count(errors.begin(), errors.end(), 0);
+    auto const lost = static_cast<int64>(instance.expected.size());
+
+    std::cout << String::formatted("buffer of %d samples: %lld notes, %lld received, %lld lost, %d unexpected", bufferSize, static_cast<long long>(scheduled), static_cast<long long>(errors.size()), static_cast<long long>(lost), instance.unexpected) << "\n";
+    std::cout << String::formatted("  jitter (samples): p50 %d, p99 %d, max %d, %.1f%% exact", percentile(0.5), percentile(0.99), percentile(1.0), errors.empty() ? 0.0 : 100.0 * static_cast<double>(exact) / static_cast<double>(errors.size())) << std::endl;
+}
+} // namespace
+
+int runMidiBench(ArgumentList const& args)
+{
+    auto getOption = [&args](const String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    };
+
+    auto seconds = getOption("--seconds", 10.0);
+    auto sampleRate = getOption("--samplerate", 48000.0);
+    auto bufferSize = static_cast<int>(getOption("--buffer", 0));
+    auto notesPerBuffer = static_cast<int>(getOption("--notes", 8));
+
+    // The processor runs whole ticks, so host buffers are multiples of pd's block size
+    if (seconds <= 0 || sampleRate <= 0 || bufferSize < 0 || bufferSize % 64 != 0 || notesPerBuffer <= 0)
+    {
+        std::cerr << "--buffer has to be a multiple of 64, --seconds, --samplerate and --notes have to be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<int> bufferSizes = {64, 256, 1024, 4096};
+    if (bufferSize > 0) bufferSizes = {bufferSize};
+
+    for (auto size : bufferSizes)
+    {
+        runMidiBufferSize(size, seconds, sampleRate, notesPerBuffer);
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Network bench: a local udp sender drives [netreceive] while pd ticks in realtime
+// Times every audio callback with the poll thread waiting for the socket, and with the audio thread polling it itself
+
+#include "Bench.h"
+
+namespace
+{
+class NetworkInstance : public BenchInstance, public pd::Instance::MessageListener
+{
+   public:
+    NetworkInstance() : BenchInstance(false)
+    {
+    }
+
+    // Runs from sendMessagesFromQueue, on the ticking thread
+    void receiveMessage(t_symbol* receiver, t_symbol* selector, int argc, t_atom* argv) override
+    {
+        received++;
+    }
+
+    void setPollThreadEnabled(bool enabled)
+    {
+        setThis();
+        sys_lock();
+        sys_setpollthread(enabled);
+        sys_unlock();
+    }
+
+    int64 received = 0;
+};
+
+// Sends small packets to the local port at a fixed rate
+class Sender : public Thread
+{
+   public:
+    Sender(int portNumber, double packetsPerSecond) : Thread("Network Bench Sender"), port(portNumber), rate(packetsPerSecond)
+    {
+    }
+
+    void run() override
+    {
+        DatagramSocket socket;
+        uint8 const packet[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+
+        auto start = Time::getHighResolutionTicks();
+
+        while (!threadShouldExit())
+        {
+            auto target = static_cast<int64>(getSecondsSince(start) * rate);
+
+            for (; sent < target; sent++)
+            {
+                socket.write("127.0.0.1", port, packet, static_cast<int>(sizeof(packet)));
+            }
+
+            Thread::sleep(1);
+        }
+    }
+
+    int64 sent = 0;
+
+   private:
+    int port;
+    double rate;
+};
+
+struct NetworkResult
+{
+    int64 sent = 0;
+    int64 received = 0;
+    Timings callbackTimes;
+};
+
+NetworkResult runNetworkPhase(NetworkInstance& instance, int port, double rate, double seconds, double sampleRate)
+{
+    int const blockSize = instance.getBlockSize();
+    auto const tickLength = static_cast<double>(blockSize) / sampleRate;
+
+    std::vector<float> inputBuffer;
+    std::vector<float> outputBuffer(static_cast<size_t>(2 * blockSize), 0.0f);
+
+    NetworkResult result;
+    result.callbackTimes.reserve(static_cast<size_t>(seconds / tickLength) + 1);
+
+    instance.received = 0;
+
+    Sender sender(port, rate);
+    sender.startThread();
+
+    auto start = Time::getHighResolutionTicks();
+
+    for (int64 tick = 0; getSecondsSince(start) < seconds; tick++)
+    {
+        auto remaining = static_cast<double>(tick) * tickLength - getSecondsSince(start);
+        if (remaining > 0.0) Thread::sleep(static_cast<int>(remaining * 1000.0));
+
+        // pd polls its sockets from the dsp tick, so the whole callback is timed
+        auto callbackStart = Time::getHighResolutionTicks();
+        instance.sendMessagesFromQueue();
+        instance.performDSP(inputBuffer.data(), outputBuffer.data());
+        instance.sendMessagesFromQueue();
+        result.callbackTimes.add(getSecondsSince(callbackStart));
+    }
+
+    sender.stopThread(1000);
+
+    result.sent = sender.sent;
+    result.received = instance.received;
+
+    // Packets still in the socket count for the next phase otherwise
+    for (int i = 0; i < 100; i++)
+    {
+        instance.performDSP(inputBuffer.data(), outputBuffer.data());
+        instance.sendMessagesFromQueue();
+        Thread::sleep(1);
+    }
+
+    return result;
+}
+} // namespace
+
+int runNetworkBench(ArgumentList const& args)
+{
+    auto getOption = [&args](const String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    };
+
+    auto seconds = getOption("--seconds", 5.0);
+    auto sampleRate = getOption("--samplerate", 48000.0);
+    auto rate = getOption("--rate", 20000.0);
+    auto port = static_cast<int>(getOption("--port", 53210));
+
+    if (seconds <= 0 || sampleRate <= 0 || rate <= 0 || port <= 0 || port > 65535)
+    {
+        std::cerr << "--seconds, --samplerate and --rate have to be positive, --port has to be a valid port" << std::endl;
+        return 1;
+    }
+
+    // Each packet comes out of [netreceive] as a list of its bytes
+    String patchText = "#N canvas 0 0 400 300 12;\n"
+                       "#X obj 10 10 netreceive -u -b " + String(port) + ";\n"
+                       "#X obj 10 40 s bench-net;\n"
+                       "#X connect 0 0 1 0;\n";
+
+    NetworkInstance instance;
+    instance.prepareDSP(0, 2, sampleRate);
+
+    TemporaryFile patchFile(".pd");
+    auto patch = openPatchFromText(instance, patchFile, patchText);
+    if (!patch.getPointer())
+    {
+        std::cerr << "Failed to open the network bench patch" << std::endl;
+        return 1;
+    }
+
+    auto* netSymbol = instance.subscribe("bench-net", &instance);
+
+    instance.startDSP();
+    instance.sendMessagesFromQueue();
+
+    std::cout << String::formatted("%.0f packets/s to port %d, ticks of %d samples at %.0f Hz", rate, port, instance.getBlockSize(), sampleRate) << "\n";
+
+    for (auto enabled : {true, false})
+    {
+        instance.setPollThreadEnabled(enabled);
+
+        auto result = runNetworkPhase(instance, port, rate, seconds, sampleRate);
+
+        std::cout << (enabled ? "with the poll thread:\n" : "polled from the audio thread:\n");
+        std::cout << String::formatted("  received: %lld of %lld packets", static_cast<long long>(result.received), static_cast<long long>(result.sent)) << "\n";
+        std::cout << "  callback time (us): " << result.callbackTimes.getSummary() << "\n";
+        std::cout << String::formatted("  callback time deviation: %.2f us", result.callbackTimes.getDeviation()) << std::endl;
+    }
+
+    instance.unsubscribe(netSymbol, &instance);
+    instance.releaseDSP();
+    instance.closePatch();
+
+    return 0;
+}
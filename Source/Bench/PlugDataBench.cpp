@@ -0,0 +1,246 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Headless renderer: runs a patch faster than realtime without an editor, host or audio device
+// Reports per-tick timing, so it can be used to catch performance regressions on a corpus of patches
+
+#include <JuceHeader.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "Bench.h"
+
+static void printUsage()
+{
+    std::cout << "Usage: plugdata-render <patch.pd> [options]\n"
+                 "       plugdata-render --bench <mode> [options]\n"
+                 "\n"
+                 "Rendering a patch:\n"
+                 "  --seconds <n>         length to render, default 10\n"
+                 "  --samplerate <n>      default 48000\n"
+                 "  --inputs <n>          input channels, fed with silence, default 2\n"
+                 "  --outputs <n>         output channels, default 2\n"
+                 "  --output <file>       write the result to a .wav file, or raw interleaved floats for any other extension\n"
+                 "  --min-realtime <n>    exit with an error when rendering is slower than n times realtime\n"
+                 "  --allow-missing       render even when some objects fail to create\n"
+                 "  --verbose             print pd's console output\n"
+                 "\n"
+                 "Bench modes:\n"
+                 "  queue                 messages/s through the queues between pd and the plugin, and the time spent\n"
+                 "                        on them per tick under --rate messages/s of parameter and midi traffic, default 10000\n"
+                 "  midi                  sample offset error of --notes note ons per host buffer, default 8, through [notein] -> [noteout]\n"
+                 "                        at host buffers of 64 to 4096 samples, or only at --buffer samples\n"
+                 "  instances             --instances pd instances, default 16, of --patch or a built-in patch of --chains filters,\n"
+                 "                        ticked from 1 up to as many threads as instances, reports the scaling\n"
+                 "  arrays                rebuilding, updating and drawing --width columns, default 1000, from the peaks of arrays\n"
+                 "                        of 64, 64k and 16M elements, or only of --size elements\n"
+                 "  routing               routes 10, 100 and 1000 connections on a synthetic patch, or only --connections,\n"
+                 "                        with one router for all of them and with a router per connection\n"
+                 "  startup               creating instances, the library scan, and loading the documentation without and with\n"
+                 "                        its cached index, --runs times each, default 5, this rewrites the index\n"
+                 "  network               audio callback times while --rate udp packets/s, default 20000, arrive at [netreceive]\n"
+                 "                        on --port, default 53210, with and without the thread that polls the sockets\n";
+}
+
+static int runBench(ArgumentList const& args)
+{
+    auto mode = args.getValueForOption("--bench");
+
+    if (mode == "queue") return runQueueBench(args);
+    if (mode == "midi") return runMidiBench(args);
+    if (mode == "instances") return runInstancesBench(args);
+    if (mode == "arrays") return runArraysBench(args);
+    if (mode == "routing") return runRoutingBench(args);
+    if (mode == "startup") return runStartupBench(args);
+    if (mode == "network") return runNetworkBench(args);
+
+    printUsage();
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    if (args.containsOption("--bench"))
+    {
+        // pd::Instance uses async callbacks, so it needs a message manager even though we never run its loop
+        ScopedJuceInitialiser_GUI juceInitialiser;
+        return runBench(args);
+    }
+
+    auto patchFile = args[0].resolveAsFile();
+    if (!patchFile.existsAsFile())
+    {
+        std::cerr << "Patch not found: " << patchFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    auto getOption = [&args](const String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    };
+
+    auto seconds = getOption("--seconds", 10.0);
+    auto sampleRate = getOption("--samplerate", 48000.0);
+    auto numInputs = static_cast<int>(getOption("--inputs", 2));
+    auto numOutputs = static_cast<int>(getOption("--outputs", 2));
+    auto minRealtime = getOption("--min-realtime", 0.0);
+    auto outputPath = args.getValueForOption("--output");
+
+    if (seconds <= 0 || sampleRate <= 0 || numInputs < 0 || numOutputs < 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    // pd::Instance uses async callbacks, so it needs a message manager even though we never run its loop
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    BenchInstance instance(args.containsOption("--verbose"));
+
+    instance.prepareDSP(numInputs, numOutputs, sampleRate);
+
+    addSearchPaths(instance);
+
+    auto patch = instance.openPatch(patchFile);
+    if (!patch.getPointer())
+    {
+        std::cerr << "Failed to open patch: " << patchFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // A patch with missing objects renders a smaller graph, which would make the timing meaningless
+    StringArray brokenObjects;
+    findBrokenObjects(patch.getPointer(), brokenObjects);
+
+    if (!brokenObjects.isEmpty())
+    {
+        std::cerr << brokenObjects.size() << " object(s) failed to create:" << std::endl;
+        for (auto& object : brokenObjects) std::cerr << "  " << object << std::endl;
+
+        if (!args.containsOption("--allow-missing")) return 1;
+    }
+
+    instance.startDSP();
+    instance.sendMessagesFromQueue();
+    instance.processPrints();
+
+    std::unique_ptr<AudioFormatWriter> wavWriter;
+    std::unique_ptr<FileOutputStream> rawStream;
+
+    if (outputPath.isNotEmpty())
+    {
+        auto outputFile = File::getCurrentWorkingDirectory().getChildFile(outputPath);
+        outputFile.deleteFile();
+
+        auto stream = std::make_unique<FileOutputStream>(outputFile);
+        if (stream->failedToOpen())
+        {
+            std::cerr << "Failed to open output file: " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        if (outputFile.hasFileExtension("wav"))
+        {
+            wavWriter.reset(WavAudioFormat().createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numOutputs), 32, {}, 0));
+            if (!wavWriter)
+            {
+                std::cerr << "Can't write a wav file with " << numOutputs << " channels" << std::endl;
+                return 1;
+            }
+            // The writer owns the stream now
+            stream.release();
+        }
+        else
+        {
+            rawStream = std::move(stream);
+        }
+    }
+
+    int const blockSize = instance.getBlockSize();
+    auto const numTicks = static_cast<int64>(std::ceil(seconds * sampleRate / blockSize));
+
+    // pd processes non-interleaved blocks, one channel after the other
+    std::vector<float> inputBuffer(static_cast<size_t>(numInputs * blockSize), 0.0f);
+    std::vector<float> outputBuffer(static_cast<size_t>(numOutputs * blockSize), 0.0f);
+    std::vector<float> interleaved(rawStream ? outputBuffer.size() : 0);
+    std::vector<const float*> channels(static_cast<size_t>(numOutputs));
+
+    for (int ch = 0; ch < numOutputs; ch++)
+    {
+        channels[ch] = outputBuffer.data() + ch * blockSize;
+    }
+
+    Timings tickTimes;
+    tickTimes.reserve(static_cast<size_t>(numTicks));
+
+    for (int64 tick = 0; tick < numTicks; tick++)
+    {
+        auto start = Time::getHighResolutionTicks();
+
+        // Same order as the plugin's processing: messages in, one dsp tick, messages out
+        instance.sendMessagesFromQueue();
+        instance.performDSP(inputBuffer.data(), outputBuffer.data());
+        instance.sendMessagesFromQueue();
+
+        tickTimes.add(getSecondsSince(start));
+
+        if (wavWriter)
+        {
+            wavWriter->writeFromFloatArrays(channels.data(), numOutputs, blockSize);
+        }
+        else if (rawStream)
+        {
+            for (int i = 0; i < blockSize; i++)
+            {
+                for (int ch = 0; ch < numOutputs; ch++)
+                {
+                    interleaved[i * numOutputs + ch] = channels[ch][i];
+                }
+            }
+            rawStream->write(interleaved.data(), interleaved.size() * sizeof(float));
+        }
+
+        // There is no message loop to drain the prints
+        if (tick % 1024 == 0) instance.processPrints();
+    }
+
+    instance.processPrints();
+    instance.releaseDSP();
+    instance.closePatch();
+
+    wavWriter.reset();
+    rawStream.reset();
+
+    auto const totalTime = tickTimes.getTotal();
+    auto renderedSeconds = static_cast<double>(numTicks * blockSize) / sampleRate;
+    auto throughput = totalTime > 0.0 ? static_cast<double>(numTicks) / totalTime : 0.0;
+    auto realtimeFactor = totalTime > 0.0 ? renderedSeconds / totalTime : 0.0;
+
+    std::cout << "patch: " << patchFile.getFullPathName() << "\n";
+    std::cout << String::formatted("rendered: %.2f s at %.0f Hz, %lld ticks of %d samples", renderedSeconds, sampleRate, static_cast<long long>(numTicks), blockSize) << "\n";
+    std::cout << "tick time (us): " << tickTimes.getSummary() << "\n";
+    std::cout << String::formatted("throughput: %.0f ticks/s, %.1fx realtime", throughput, realtimeFactor) << "\n";
+    std::cout << String::formatted("peak memory: %.1f MB", static_cast<double>(getPeakMemoryUsage()) / (1024.0 * 1024.0)) << std::endl;
+
+    if (minRealtime > 0.0 && realtimeFactor < minRealtime)
+    {
+        std::cerr << String::formatted("Rendering at %.1fx realtime is below the required %.1fx", realtimeFactor, minRealtime) << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Queue bench: parameter and midi traffic from another thread, through the send queue into pd and back out through the receive queue
+// Runs once saturated for throughput, then paced at --rate messages/s with realtime ticks for the time the queues take per tick
+
+#include "Bench.h"
+
+namespace
+{
+char const* queuePatch =
+    "#N canvas 0 0 400 300 12;\n"
+    "#X obj 10 10 r bench-param;\n"
+    "#X obj 10 40 s bench-out;\n"
+    "#X obj 150 10 r bench-midi;\n"
+    "#X obj 150 40 unpack f f;\n"
+    "#X obj 150 70 noteout 1;\n"
+    "#X connect 0 0 1 0;\n"
+    "#X connect 2 0 3 0;\n"
+    "#X connect 3 0 4 0;\n"
+    "#X connect 3 1 4 1;\n";
+
+class QueueInstance : public BenchInstance, public pd::Instance::MessageListener
+{
+   public:
+    QueueInstance() : BenchInstance(false)
+    {
+    }
+
+    // Both run from sendMessagesFromQueue, on the ticking thread
+    void receiveMessage(t_symbol* receiver, t_symbol* selector, int argc, t_atom* argv) override
+    {
+        received++;
+    }
+
+    void receiveNoteOn(const int channel, const int pitch, const int velocity) override
+    {
+        received++;
+    }
+
+    int64 received = 0;
+};
+
+// Alternates parameter changes and note ons, as fast as possible or at a fixed rate
+class Producer : public Thread
+{
+   public:
+    Producer(QueueInstance& pd, double messagesPerSecond) : Thread("Queue Bench Producer"), instance(pd), rate(messagesPerSecond)
+    {
+        paramSymbol = instance.generateSymbol("bench-param");
+        midiSymbol = instance.generateSymbol("bench-midi");
+        listSymbol = instance.generateSymbol("list");
+    }
+
+    void run() override
+    {
+        auto start = Time::getHighResolutionTicks();
+
+        while (!threadShouldExit())
+        {
+            auto target = rate > 0.0 ? static_cast<int64>(getSecondsSince(start) * rate) : sent.load() + 64;
+
+            for (auto count = sent.load(); count < target; count++)
+            {
+                if (count % 2 == 0)
+                {
+                    instance.enqueueMessages(paramSymbol, listSymbol, {static_cast<float>(count % 128) / 127.0f});
+                }
+                else
+                {
+                    instance.enqueueMessages(midiSymbol, listSymbol, {60.0f, 100.0f});
+                }
+                sent.store(count + 1);
+            }
+
+            if (rate > 0.0) Thread::sleep(1);
+        }
+    }
+
+    std::atomic<int64> sent = 0;
+
+   private:
+    QueueInstance& instance;
+    double rate;
+
+    t_symbol* paramSymbol;
+    t_symbol* midiSymbol;
+    t_symbol* listSymbol;
+};
+
+struct QueueResult
+{
+    double seconds = 0.0;
+    int64 sent = 0;
+    int64 delivered = 0;
+    Timings queueTimes;
+};
+
+QueueResult runQueuePhase(QueueInstance& instance, double rate, double seconds, double sampleRate)
+{
+    int const blockSize = instance.getBlockSize();
+    auto const tickLength = static_cast<double>(blockSize) / sampleRate;
+
+    std::vector<float> inputBuffer;
+    std::vector<float> outputBuffer(static_cast<size_t>(2 * blockSize), 0.0f);
+
+    QueueResult result;
+    result.queueTimes.reserve(static_cast<size_t>(seconds / tickLength) + 1);
+
+    instance.received = 0;
+
+    Producer producer(instance, rate);
+    producer.startThread();
+
+    auto start = Time::getHighResolutionTicks();
+
+    for (int64 tick = 0; getSecondsSince(start) < seconds; tick++)
+    {
+        // Paced runs tick in realtime, like an audio callback would
+        if (rate > 0.0)
+        {
+            auto remaining = static_cast<double>(tick) * tickLength - getSecondsSince(start);
+            if (remaining > 0.0) Thread::sleep(static_cast<int>(remaining * 1000.0));
+        }
+
+        auto queueStart = Time::getHighResolutionTicks();
+        instance.sendMessagesFromQueue();
+        auto queueTime = getSecondsSince(queueStart);
+
+        instance.performDSP(inputBuffer.data(), outputBuffer.data());
+
+        queueStart = Time::getHighResolutionTicks();
+        instance.sendMessagesFromQueue();
+        queueTime += getSecondsSince(queueStart);
+
+        result.queueTimes.add(queueTime);
+    }
+
+    producer.stopThread(1000);
+    result.seconds = getSecondsSince(start);
+
+    // What's still queued was sent in time, so it counts as delivered
+    instance.sendMessagesFromQueue();
+    instance.sendMessagesFromQueue();
+
+    result.sent = producer.sent.load();
+    result.delivered = instance.received;
+
+    return result;
+}
+} // namespace
+
+int runQueueBench(ArgumentList const& args)
+{
+    auto getOption = [&args](const String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    };
+
+    auto seconds = getOption("--seconds", 5.0);
+    auto sampleRate = getOption("--samplerate", 48000.0);
+    auto rate = getOption("--rate", 10000.0);
+
+    if (seconds <= 0 || sampleRate <= 0 || rate <= 0)
+    {
+        std::cerr << "--seconds, --samplerate and --rate have to be positive" << std::endl;
+        return 1;
+    }
+
+    QueueInstance instance;
+    instance.prepareDSP(0, 2, sampleRate);
+
+    TemporaryFile patchFile(".pd");
+    auto patch = openPatchFromText(instance, patchFile, queuePatch);
+    if (!patch.getPointer())
+    {
+        std::cerr << "Failed to open the queue bench patch" << std::endl;
+        return 1;
+    }
+
+    auto* outSymbol = instance.subscribe("bench-out", &instance);
+
+    instance.startDSP();
+    instance.sendMessagesFromQueue();
+
+    auto const tickBudget = static_cast<double>(instance.getBlockSize()) / sampleRate * 1e6;
+
+    auto saturated = runQueuePhase(instance, 0.0, seconds, sampleRate);
+
+    std::cout << "saturated:\n";
+    std::cout << String::formatted("  delivered: %.0f messages/s, %lld of %lld sent, %lld dropped", static_cast<double>(saturated.delivered) / saturated.seconds, static_cast<long long>(saturated.delivered), static_cast<long long>(saturated.sent), static_cast<long long>(saturated.sent - saturated.delivered)) << "\n";
+
+    auto paced = runQueuePhase(instance, rate, seconds, sampleRate);
+
+    std::cout << String::formatted("paced at %.0f messages/s, ticks of %d samples at %.0f Hz:", rate, instance.getBlockSize(), sampleRate) << "\n";
+    std::cout << String::formatted("  delivered: %lld of %lld sent, %lld dropped", static_cast<long long>(paced.delivered), static_cast<long long>(paced.sent), static_cast<long long>(paced.sent - paced.delivered)) << "\n";
+    std::cout << "  queue time per tick (us): " << paced.queueTimes.getSummary() << "\n";
+    std::cout << String::formatted("  worst tick spends %.1f%% of its %.0f us budget on the queues", paced.queueTimes.getPercentile(1.0) / tickBudget * 100.0, tickBudget) << std::endl;
+
+    instance.unsubscribe(outSymbol, &instance);
+    instance.releaseDSP();
+    instance.closePatch();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Routing bench: connections between boxes on a synthetic patch, routed 10, 100 and 1000 at a time
+// Times the batch router that moves use, and a router per connection like a single cord being routed
+
+#include "Bench.h"
+
+#include "../ConnectionRouter.h"
+
+#include <cmath>
+
+namespace
+{
+struct SyntheticPatch
+{
+    // Box sized objects on a jittered grid, with most connections going down to nearby boxes
+    SyntheticPatch(int numConnections)
+    {
+        Random random(0x726f7574);
+
+        int const numBoxes = std::max(20, numConnections);
+        int const columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numBoxes))));
+
+        for (int i = 0; i < numBoxes; i++)
+        {
+            auto x = (i % columns) * 160 + random.nextInt(40);
+            auto y = (i / columns) * 90 + random.nextInt(20);
+            boxes.push_back(Rectangle<int>(x, y, 60 + random.nextInt(60), 24));
+        }
+
+        for (int i = 0; i < numConnections; i++)
+        {
+            int const from = random.nextInt(numBoxes);
+            int const column = jlimit(0, columns - 1, from % columns + random.nextInt(5) - 2);
+
+            // One in ten goes back up, like a feedback connection
+            int const rowOffset = random.nextInt(10) == 0 ? -1 - random.nextInt(2) : 1 + random.nextInt(3);
+            int const row = from / columns + rowOffset;
+            int const to = jlimit(0, numBoxes - 1, row * columns + column);
+
+            if (to == from) continue;
+
+            auto const& outletBounds = boxes[from];
+            auto const& inletBounds = boxes[to];
+
+            connections.push_back({to, from, Point<int>(inletBounds.getX() + 5, inletBounds.getY()), Point<int>(outletBounds.getX() + 5, outletBounds.getBottom())});
+        }
+    }
+
+    // The router only compares boxes, so the bounds stand in for them
+    Box* getBox(int index)
+    {
+        return reinterpret_cast<Box*>(&boxes[index]);
+    }
+
+    struct SyntheticConnection
+    {
+        int inletBox, outletBox;
+        Point<int> inletPos, outletPos;
+    };
+
+    std::vector<Rectangle<int>> boxes;
+    std::vector<SyntheticConnection> connections;
+};
+
+void runRoutingSize(int numConnections)
+{
+    SyntheticPatch patch(numConnections);
+
+    int failed = 0;
+    Timings batchTimes;
+    Timings singleTimes;
+
+    auto routeConnection = [&](ConnectionRouter const& router, SyntheticPatch::SyntheticConnection const& connection)
+    {
+        auto path = router.route(connection.inletPos, patch.getBox(connection.inletBox), connection.outletPos, patch.getBox(connection.outletBox));
+        if (path.empty()) failed++;
+    };
+
+    // A move re-routes all its connections with one router, made from the boxes in the union of their areas
+    auto batchStart = Time::getHighResolutionTicks();
+
+    Rectangle<int> area;
+    for (auto& connection : patch.connections)
+    {
+        auto routingArea = ConnectionRouter::getRoutingArea(connection.inletPos, connection.outletPos);
+        area = area.isEmpty() ? routingArea : area.getUnion(routingArea);
+    }
+
+    ConnectionRouter batchRouter;
+    for (int i = 0; i < static_cast<int>(patch.boxes.size()); i++)
+    {
+        if (patch.boxes[i].intersects(area)) batchRouter.addObstacle(patch.getBox(i), patch.boxes[i]);
+    }
+
+    auto const obstacleTime = getSecondsSince(batchStart);
+
+    for (auto& connection : patch.connections)
+    {
+        auto start = Time::getHighResolutionTicks();
+        routeConnection(batchRouter, connection);
+        batchTimes.add(getSecondsSince(start));
+    }
+
+    auto const batchTime = getSecondsSince(batchStart);
+    auto const batchFailed = failed;
+    failed = 0;
+
+    // A single cord collects the boxes near it for itself
+    for (auto& connection : patch.connections)
+    {
+        auto start = Time::getHighResolutionTicks();
+
+        auto routingArea = ConnectionRouter::getRoutingArea(connection.inletPos, connection.outletPos);
+
+        ConnectionRouter router;
+        for (int i = 0; i < static_cast<int>(patch.boxes.size()); i++)
+        {
+            if (patch.boxes[i].intersects(routingArea)) router.addObstacle(patch.getBox(i), patch.boxes[i]);
+        }
+
+        routeConnection(router, connection);
+        singleTimes.add(getSecondsSince(start));
+    }
+
+    std::cout << patch.connections.size() << " connections between " << patch.boxes.size() << " boxes:\n";
+    std::cout << String::formatted("  batch: %.2f ms, %.2f ms collecting obstacles, %d without a route", batchTime * 1e3, obstacleTime * 1e3, batchFailed) << "\n";
+    std::cout << "  batch route per connection (us): " << batchTimes.getSummary() << "\n";
+    std::cout << String::formatted("  one router per connection: %.2f ms, %d without a route", singleTimes.getTotal() * 1e3, failed) << "\n";
+    std::cout << "  single route per connection (us): " << singleTimes.getSummary() << std::endl;
+}
+} // namespace
+
+int runRoutingBench(ArgumentList const& args)
+{
+    auto numConnections = args.getValueForOption("--connections").getIntValue();
+
+    if (numConnections < 0)
+    {
+        std::cerr << "--connections has to be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<int> sizes = {10, 100, 1000};
+    if (numConnections > 0) sizes = {numConnections};
+
+    for (auto size : sizes)
+    {
+        runRoutingSize(size);
+    }
+
+    return 0;
+}
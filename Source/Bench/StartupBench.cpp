@@ -0,0 +1,121 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+// Startup bench: what creating a plugin instance costs before it can be used
+// libpd and class setup for the first instance, every next instance, the library scan in the processor's constructor,
+// and loading the documentation index in the background, from the pddoc files and from the cached index
+
+#include "Bench.h"
+
+#include "../Pd/PdLibrary.h"
+
+extern "C"
+{
+#include "x_libpd_multi.h"
+}
+
+namespace
+{
+// Same location as the index that DocumentationIndex writes
+File getDocumentationDirectory()
+{
+    return File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("PlugData").getChildFile("Documentation");
+}
+
+// Time until a new index has the documentation, like the first instance in a process waits for it
+double loadDocumentation(bool& loaded)
+{
+    auto start = Time::getHighResolutionTicks();
+
+    pd::DocumentationIndex index;
+    index.load();
+
+    // Loading gives up after a minute, a broken directory shouldn't hang the bench
+    while (!index.get() && getSecondsSince(start) < 60.0) Thread::sleep(1);
+
+    loaded = index.get() != nullptr;
+    return getSecondsSince(start);
+}
+} // namespace
+
+int runStartupBench(ArgumentList const& args)
+{
+    auto runs = args.getValueForOption("--runs").getIntValue();
+    if (runs < 0)
+    {
+        std::cerr << "--runs has to be positive" << std::endl;
+        return 1;
+    }
+
+    if (runs == 0) runs = 5;
+
+    auto start = Time::getHighResolutionTicks();
+    auto firstInstance = std::make_unique<BenchInstance>(false);
+    auto const firstInstanceTime = getSecondsSince(start);
+
+    double libpdInitTime, classSetupTime;
+    libpd_multi_get_init_times(&libpdInitTime, &classSetupTime);
+
+    Timings instanceTimes;
+    for (int i = 0; i < runs; i++)
+    {
+        start = Time::getHighResolutionTicks();
+        BenchInstance instance(false);
+        instanceTimes.add(getSecondsSince(start));
+    }
+
+    // The library scan runs in the processor's constructor, the documentation loads in the background
+    Timings libraryTimes;
+    for (int i = 0; i < runs; i++)
+    {
+        firstInstance->setThis();
+
+        start = Time::getHighResolutionTicks();
+        pd::Library library;
+        library.initialiseLibrary();
+        libraryTimes.add(getSecondsSince(start));
+    }
+
+    std::cout << String::formatted("first instance: %.1f ms, libpd init %.1f ms, class setup %.1f ms", firstInstanceTime * 1e3, libpdInitTime * 1e3, classSetupTime * 1e3) << "\n";
+    std::cout << "next instances (us): " << instanceTimes.getSummary() << "\n";
+    std::cout << "library scan (us): " << libraryTimes.getSummary() << "\n";
+
+    auto documentationDir = getDocumentationDirectory();
+    auto indexFile = documentationDir.getChildFile("pddoc.index");
+
+    if (!documentationDir.getChildFile("pddoc").isDirectory())
+    {
+        std::cout << "no documentation at " << documentationDir.getFullPathName() << ", open plugdata once to install it" << std::endl;
+        return 0;
+    }
+
+    // Without an index every pddoc file is parsed, and the index is written again
+    Timings coldTimes;
+    Timings cachedTimes;
+    bool loaded = true;
+
+    for (int i = 0; i < runs && loaded; i++)
+    {
+        indexFile.deleteFile();
+        coldTimes.add(loadDocumentation(loaded));
+    }
+
+    for (int i = 0; i < runs && loaded; i++)
+    {
+        cachedTimes.add(loadDocumentation(loaded));
+    }
+
+    if (!loaded)
+    {
+        std::cerr << "Loading the documentation took longer than a minute" << std::endl;
+        return 1;
+    }
+
+    std::cout << "documentation from the pddoc files (us): " << coldTimes.getSummary() << "\n";
+    std::cout << "documentation from the index (us): " << cachedTimes.getSummary() << std::endl;
+
+    return 0;
+}
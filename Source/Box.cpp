@@ -42,6 +42,11 @@ Box::Box(pd::Object* object, Canvas* parent, const String& name) : pdObject(obje
     setType(name, true);
 }
 
+Box::~Box()
+{
+    cnv->boxGrid.remove(this);
+}
+
 void Box::initialise()
 {
     addMouseListener(cnv, true);  // Receive mouse messages on canvas
@@ -201,9 +206,14 @@ void Box::setType(const String& newType, bool exists)
     // When setting exists to true, the pdObject need to be assigned already
     if (!exists)
     {
+        cnv->pd->objectLibrary.registerUsage(type);
+
         auto* pd = &cnv->patch;
         if (pdObject)
         {
+            // Renaming may recreate a subpatch from its text
+            cnv->pd->storeExtraInfo();
+
             pdObject = pd->renameObject(pdObject.get(), newType);
 
             // Synchronise to make sure connections are preserved correctly
@@ -305,6 +315,12 @@ void Box::paint(Graphics& g)
         g.fillRect(getLocalBounds().reduced(margin));
     }
 
+    if (profileHeat > 0.0f)
+    {
+        g.setColour(Colours::red.withAlpha(profileHeat * 0.6f));
+        g.fillRect(rect);
+    }
+
     // Draw comment style
     if (graphics && graphics->getGui().getType() == pd::Type::Comment)
     {
@@ -334,8 +350,15 @@ void Box::paint(Graphics& g)
     }
 }
 
+void Box::moved()
+{
+    cnv->boxGrid.update(this, getBounds());
+}
+
 void Box::resized()
 {
+    cnv->boxGrid.update(this, getBounds());
+
     if (graphics)
     {
         graphics->setBounds(getLocalBounds().reduced(margin));
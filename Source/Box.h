@@ -26,10 +26,13 @@ class Box : public Component, public Value::Listener, private TextEditor::Listen
 
     Box(pd::Object* object, Canvas* parent, const String& name = "");
 
+    ~Box() override;
+
     void valueChanged(Value& v) override;
 
     void paint(Graphics&) override;
     void resized() override;
+    void moved() override;
 
     void updatePorts();
 
@@ -78,6 +81,9 @@ class Box : public Component, public Value::Listener, private TextEditor::Listen
     bool selectionChanged = false;
     bool hideLabel = false;
 
+    // Share of dsp time relative to the heaviest object, drawn as a tint while profiling
+    float profileHeat = 0.0f;
+
     String currentText;
 
    private:
@@ -0,0 +1,151 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <unordered_map>
+#include <vector>
+
+class Box;
+
+// Uniform grid of box bounds in canvas coordinates
+// Boxes keep their entry up to date when they move, resize or get deleted,
+// so area queries for routing, lasso selection and hovering only visit nearby boxes
+class BoxGrid
+{
+   public:
+    void update(Box* box, Rectangle<int> bounds)
+    {
+        auto it = entries.find(box);
+
+        if (it == entries.end())
+        {
+            entries[box] = bounds;
+            addToCells(box, getCellRange(bounds));
+            return;
+        }
+
+        auto oldCells = getCellRange(it->second);
+        auto newCells = getCellRange(bounds);
+
+        it->second = bounds;
+
+        if (oldCells != newCells)
+        {
+            removeFromCells(box, oldCells);
+            addToCells(box, newCells);
+        }
+    }
+
+    void remove(Box* box)
+    {
+        auto it = entries.find(box);
+        if (it == entries.end()) return;
+
+        removeFromCells(box, getCellRange(it->second));
+        entries.erase(it);
+    }
+
+    // Returns all boxes whose bounds touch the area, each box only once
+    Array<Box*> findBoxes(Rectangle<int> area) const
+    {
+        Array<Box*> result;
+
+        auto queryCells = getCellRange(area);
+
+        // For areas that cover more cells than there are boxes, checking every box is cheaper
+        if (static_cast<size_t>(queryCells.getWidth() + 1) * static_cast<size_t>(queryCells.getHeight() + 1) > entries.size())
+        {
+            for (auto& [box, bounds] : entries)
+            {
+                if (touches(bounds, area)) result.add(box);
+            }
+            return result;
+        }
+
+        for (int y = queryCells.getY(); y <= queryCells.getBottom(); y++)
+        {
+            for (int x = queryCells.getX(); x <= queryCells.getRight(); x++)
+            {
+                auto cell = cells.find(getCellKey(x, y));
+                if (cell == cells.end()) continue;
+
+                for (auto* box : cell->second)
+                {
+                    auto& bounds = entries.at(box);
+                    if (!touches(bounds, area)) continue;
+
+                    // A box that spans multiple cells is only reported from the first cell it shares with the query
+                    auto boxCells = getCellRange(bounds);
+                    if (x == std::max(boxCells.getX(), queryCells.getX()) && y == std::max(boxCells.getY(), queryCells.getY()))
+                    {
+                        result.add(box);
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+   private:
+    static inline constexpr int cellSize = 128;
+
+    static int getCell(int coordinate)
+    {
+        return coordinate >= 0 ? coordinate / cellSize : (coordinate - cellSize + 1) / cellSize;
+    }
+
+    static int64 getCellKey(int x, int y)
+    {
+        return (static_cast<int64>(x) << 32) | static_cast<uint32>(y);
+    }
+
+    // Range of cells covered by the bounds, with inclusive right and bottom edges
+    static Rectangle<int> getCellRange(Rectangle<int> bounds)
+    {
+        return Rectangle<int>::leftTopRightBottom(getCell(bounds.getX()), getCell(bounds.getY()), getCell(bounds.getRight()), getCell(bounds.getBottom()));
+    }
+
+    // Inclusive overlap test, so zero-sized areas like straight lines still find the boxes they touch
+    static bool touches(Rectangle<int> a, Rectangle<int> b)
+    {
+        return a.getX() <= b.getRight() && b.getX() <= a.getRight() && a.getY() <= b.getBottom() && b.getY() <= a.getBottom();
+    }
+
+    void addToCells(Box* box, Rectangle<int> range)
+    {
+        for (int y = range.getY(); y <= range.getBottom(); y++)
+        {
+            for (int x = range.getX(); x <= range.getRight(); x++)
+            {
+                cells[getCellKey(x, y)].push_back(box);
+            }
+        }
+    }
+
+    void removeFromCells(Box* box, Rectangle<int> range)
+    {
+        for (int y = range.getY(); y <= range.getBottom(); y++)
+        {
+            for (int x = range.getX(); x <= range.getRight(); x++)
+            {
+                auto cell = cells.find(getCellKey(x, y));
+                if (cell == cells.end()) continue;
+
+                auto& boxesInCell = cell->second;
+                boxesInCell.erase(std::remove(boxesInCell.begin(), boxesInCell.end(), box), boxesInCell.end());
+
+                if (boxesInCell.empty()) cells.erase(cell);
+            }
+        }
+    }
+
+    std::unordered_map<Box*, Rectangle<int>> entries;
+    std::unordered_map<int64, std::vector<Box*>> cells;
+};
@@ -16,6 +16,10 @@ extern "C"
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 // Suggestions component that shows up when objects are edited
 class SuggestionComponent : public Component, public KeyListener, public TextEditor::InputFilter
 {
@@ -267,18 +271,21 @@ class SuggestionComponent : public Component, public KeyListener, public TextEdi
         // Update suggestions
         auto found = library.autocomplete(typedText.toStdString());
 
+        // Descriptions are loaded in the background and may not be available yet
+        auto docs = library.documentation->get();
+
         for (int i = 0; i < std::min<int>(buttons.size(), found.size()); i++)
         {
             auto& [name, autocomplete] = found[i];
 
-            if (library.objectDescriptions.find(name) != library.objectDescriptions.end())
+            String description;
+            if (docs)
             {
-                buttons[i]->setText(name, library.objectDescriptions[name]);
-            }
-            else
-            {
-                buttons[i]->setText(name, "");
+                auto it = docs->descriptions.find(name);
+                if (it != docs->descriptions.end()) description = it->second;
             }
+
+            buttons[i]->setText(name, description);
         }
 
         for (int i = found.size(); i < buttons.size(); i++) buttons[i]->setText("", "");
@@ -471,6 +478,8 @@ Canvas::Canvas(PlugDataPluginEditor& parent, pd::Patch p, bool graph, bool graph
         patch.setExtraInfo("BackgroundColour", block);
     }
 
+    auto memblock = patch.getExtraInfo("BackgroundColour");
+    backgroundColour = Colour::fromString(MemoryInputStream(std::move(memblock)).readString());
 
     synchronise();
 }
@@ -485,9 +494,6 @@ void Canvas::paint(Graphics& g)
 {
     if (!isGraph)
     {
-        auto memblock = patch.getExtraInfo("BackgroundColour");
-        backgroundColour = Colour::fromString(MemoryInputStream(std::move(memblock)).readString());
-        
         g.fillAll(findColour(ComboBox::backgroundColourId));
 
         g.setColour(backgroundColour);
@@ -534,25 +540,24 @@ void Canvas::synchronise(bool updatePosition)
     deselectAll();
 
     patch.setCurrent(true);
-    patch.updateExtraInfo();
 
     auto objects = patch.getObjects();
-    auto isObjectDeprecated = [&](pd::Object* obj)
+
+    // Index pd objects and boxes by pointer, so every lookup below is constant time instead of a scan
+    std::unordered_map<void*, size_t> objectIndex;
+    objectIndex.reserve(objects.size());
+    for (size_t i = 0; i < objects.size(); i++)
     {
-        // NOTE: replace with std::ranges::all_of when available
-        for (auto& pdobj : objects)
-        {
-            if (pdobj == *obj)
-            {
-                return false;
-            }
-        }
-        return true;
-    };
+        objectIndex[objects[i].getPointer()] = i;
+    }
+
+    auto isObjectDeprecated = [&](pd::Object* obj) { return !obj || !objectIndex.count(obj->getPointer()); };
+
+    bool editable = !(isGraph || presentationMode == var(true));
 
-    if (!(isGraph || presentationMode == var(true)))
+    if (editable)
     {
-        // Remove deprecated connections
+        // Remove connections to deleted objects
         for (int n = connections.size() - 1; n >= 0; n--)
         {
             auto connection = connections[n];
@@ -561,16 +566,6 @@ void Canvas::synchronise(bool updatePosition)
             {
                 connections.remove(n);
             }
-            else
-            {
-                auto* inlet = static_cast<t_text*>(connection->inlet->box->pdObject->getPointer());
-                auto* outlet = static_cast<t_text*>(connection->outlet->box->pdObject->getPointer());
-
-                if (!canvas_isconnected(patch.getPointer(), outlet, connection->outIdx, inlet, connection->inIdx))
-                {
-                    connections.remove(n);
-                }
-            }
         }
     }
 
@@ -584,11 +579,18 @@ void Canvas::synchronise(bool updatePosition)
         }
     }
 
+    std::unordered_map<void*, Box*> boxIndex;
+    boxIndex.reserve(objects.size());
+    for (auto* box : boxes)
+    {
+        if (box->pdObject) boxIndex[box->pdObject->getPointer()] = box;
+    }
+
     for (auto& object : objects)
     {
-        auto it = std::find_if(boxes.begin(), boxes.end(), [&object](Box* b) { return b->pdObject && *b->pdObject == object; });
+        auto it = boxIndex.find(object.getPointer());
 
-        if (it == boxes.end())
+        if (it == boxIndex.end())
         {
             auto name = String(object.getText());
 
@@ -603,10 +605,12 @@ void Canvas::synchronise(bool updatePosition)
 
             // Don't show non-patchable (internal) objects
             if (!pd::Patch::checkObject(&object)) newBox->setVisible(false);
+
+            boxIndex[object.getPointer()] = newBox;
         }
         else
         {
-            auto* box = *it;
+            auto* box = it->second;
 
             // Only update positions if we need to and there is a significant difference
             // There may be rounding errors when scaling the gui, this makes the experience smoother
@@ -621,58 +625,60 @@ void Canvas::synchronise(bool updatePosition)
     }
 
     // Make sure objects have the same order
-    std::sort(boxes.begin(), boxes.end(),
-              [&objects](Box* first, Box* second) mutable
-              {
-                  size_t idx1 = std::find(objects.begin(), objects.end(), *first->pdObject) - objects.begin();
-                  size_t idx2 = std::find(objects.begin(), objects.end(), *second->pdObject) - objects.begin();
-
-                  return idx1 < idx2;
-              });
+    auto getObjectIndex = [&objectIndex, numObjects = objects.size()](Box* box)
+    {
+        if (!box->pdObject) return numObjects;
+        auto it = objectIndex.find(box->pdObject->getPointer());
+        return it != objectIndex.end() ? it->second : numObjects;
+    };
 
-    auto pdConnections = patch.getConnections();
+    std::sort(boxes.begin(), boxes.end(), [&getObjectIndex](Box* first, Box* second) { return getObjectIndex(first) < getObjectIndex(second); });
 
-    if (!(isGraph || presentationMode == var(true)))
+    if (editable)
     {
-        for (auto& connection : pdConnections)
+        // Group existing connections by the box they start from, so matching a pd connection only looks at that box's outlets
+        std::unordered_map<Box*, std::vector<Connection*>> connectionIndex;
+        for (auto* c : connections)
         {
-            auto& [inno, inobj, outno, outobj] = connection;
+            if (c->inlet && c->outlet) connectionIndex[c->outlet->box].push_back(c);
+        }
 
-            int srcno = patch.getIndex(&inobj->te_g);
-            int sinkno = patch.getIndex(&outobj->te_g);
+        std::unordered_set<Connection*> synchronised;
 
-            auto& srcEdges = boxes[srcno]->edges;
-            auto& sinkEdges = boxes[sinkno]->edges;
+        for (auto& connection : patch.getConnections())
+        {
+            auto& [inno, inobj, outno, outobj] = connection;
+
+            auto srcIter = boxIndex.find(&inobj->te_g);
+            auto sinkIter = boxIndex.find(&outobj->te_g);
 
             // TEMP: remove when we're sure this works
-            if (srcno >= boxes.size() || sinkno >= boxes.size() || outno >= srcEdges.size() || inno >= sinkEdges.size())
+            if (srcIter == boxIndex.end() || sinkIter == boxIndex.end() || srcIter->second->numInputs + outno >= srcIter->second->edges.size() || inno >= sinkIter->second->edges.size())
             {
                 pd->logError("Error: impossible connection");
                 continue;
             }
 
-            auto it = std::find_if(connections.begin(), connections.end(),
-                                   [this, &connection, &srcno, &sinkno](Connection* c)
-                                   {
-                                       auto& [inno, inobj, outno, outobj] = connection;
+            auto* src = srcIter->second;
+            auto* sink = sinkIter->second;
 
-                                       if (!c->inlet || !c->outlet) return false;
+            auto& candidates = connectionIndex[src];
+            auto it = std::find_if(candidates.begin(), candidates.end(), [&](Connection* c) { return c->inlet->box == sink && c->inIdx == inno && c->outIdx == outno; });
 
-                                       bool sameStart = c->outlet->box == boxes[srcno];
-                                       bool sameEnd = c->inlet->box == boxes[sinkno];
-
-                                       return c->inIdx == inno && c->outIdx == outno && sameStart && sameEnd;
-                                   });
-
-            if (it == connections.end())
+            if (it == candidates.end())
             {
-                connections.add(new Connection(this, srcEdges[boxes[srcno]->numInputs + outno], sinkEdges[inno], true));
+                auto* newConnection = connections.add(new Connection(this, src->edges[src->numInputs + outno], sink->edges[inno], true));
+                synchronised.insert(newConnection);
+
+                auto info = patch.getExtraInfo(newConnection->getId(objectIndex));
+                if (info.getSize()) newConnection->setState(info);
             }
             else
             {
                 auto& c = *(*it);
+                synchronised.insert(&c);
 
-                auto currentId = c.getId();
+                auto currentId = c.getId(objectIndex);
                 if (c.lastId.isNotEmpty() && c.lastId != currentId)
                 {
                     patch.setExtraInfoId(c.lastId, currentId);
@@ -685,6 +691,15 @@ void Canvas::synchronise(bool updatePosition)
             }
         }
 
+        // Remove connections that no longer exist in pd
+        for (int n = connections.size() - 1; n >= 0; n--)
+        {
+            if (!synchronised.count(connections[n]))
+            {
+                connections.remove(n);
+            }
+        }
+
         setTransform(main.transform);
         updateDrawables();
     }
@@ -1121,6 +1136,9 @@ void Canvas::deselectAll()
 
 void Canvas::copySelection()
 {
+    // Subpatches get copied with their plugdatainfo comment, so that needs to be up to date
+    pd->storeExtraInfo();
+
     // Tell pd to select all objects that are currently selected
     for (auto* sel : getLassoSelection())
     {
@@ -1138,49 +1156,50 @@ void Canvas::copySelection()
 void Canvas::pasteSelection()
 {
     // Tell pd to paste
-    patch.paste();
-
-    // Load state from pd, don't update positions
-    synchronise(false);
+    pd::Patch::Transaction transaction;
+    transaction.paste(SystemClipboard::getTextFromClipboard());
 
-    for (auto* box : boxes)
-    {
-        if (glist_isselected(patch.getPointer(), static_cast<t_gobj*>(box->pdObject->getPointer())))
-        {
-            setSelected(box, true);
-        }
-    }
-
-    patch.deselectAll();
+    patch.performTransaction(std::move(transaction), [_this = SafePointer<Canvas>(this)](std::vector<t_pd*> const& created) {
+        if (_this) _this->synchroniseAndSelect(created);
+    });
 }
 
 void Canvas::duplicateSelection()
 {
-    // Tell pd to select all objects that are currently selected
+    pd->storeExtraInfo();
+
+    std::vector<pd::Object*> objects;
     for (auto* sel : getLassoSelection())
     {
         if (auto* box = dynamic_cast<Box*>(sel))
         {
-            patch.selectObject(box->pdObject.get());
+            if (box->pdObject) objects.push_back(box->pdObject.get());
         }
     }
 
     // Tell pd to duplicate
-    patch.duplicate();
+    pd::Patch::Transaction transaction;
+    transaction.duplicate(objects);
 
+    patch.performTransaction(std::move(transaction), [_this = SafePointer<Canvas>(this)](std::vector<t_pd*> const& created) {
+        if (_this) _this->synchroniseAndSelect(created);
+    });
+}
+
+void Canvas::synchroniseAndSelect(std::vector<t_pd*> const& objects)
+{
     // Load state from pd, don't update positions
     synchronise(false);
 
-    // Select the newly duplicated objects
+    std::unordered_set<void*> toSelect(objects.begin(), objects.end());
+
     for (auto* box : boxes)
     {
-        if (glist_isselected(patch.getPointer(), static_cast<t_gobj*>(box->pdObject->getPointer())))
+        if (box->pdObject && toSelect.count(box->pdObject->getPointer()))
         {
             setSelected(box, true);
         }
     }
-
-    patch.deselectAll();
 }
 
 void Canvas::removeSelection()
@@ -1188,39 +1207,39 @@ void Canvas::removeSelection()
     // Make sure object isn't selected and stop updating gui
     main.sidebar.hideParameters();
 
-    // Make sure nothing is selected
-    patch.deselectAll();
+    // The undo action stores the removed subpatches as text
+    pd->storeExtraInfo();
 
-    // Find selected objects and make them selected in pd
-    Array<pd::Object*> objects;
+    // Find selected objects
+    std::vector<pd::Object*> objects;
     for (auto* sel : getLassoSelection())
     {
         if (auto* box = dynamic_cast<Box*>(sel))
         {
-            if (box->pdObject)
-            {
-                patch.selectObject(box->pdObject.get());
-                objects.add(box->pdObject.get());
-            }
+            if (box->pdObject) objects.push_back(box->pdObject.get());
         }
     }
 
-    // remove selection
-    patch.removeSelection();
+    pd::Patch::Transaction transaction;
+    transaction.removeObjects(objects);
+
+    auto isRemoved = [&objects](pd::Object* obj) { return std::find(objects.begin(), objects.end(), obj) != objects.end(); };
 
     // Remove connection afterwards and make sure they aren't already deleted
     for (auto* con : connections)
     {
         if (isSelected(con))
         {
-            if (!(objects.contains(con->outlet->box->pdObject.get()) || objects.contains(con->inlet->box->pdObject.get())))
+            if (!(isRemoved(con->outlet->box->pdObject.get()) || isRemoved(con->inlet->box->pdObject.get())))
             {
-                patch.removeConnection(con->outlet->box->pdObject.get(), con->outIdx, con->inlet->box->pdObject.get(), con->inIdx);
+                transaction.removeConnection(con->outlet->box->pdObject.get(), con->outIdx, con->inlet->box->pdObject.get(), con->inIdx);
             }
         }
     }
 
-    patch.finishRemove();  // Makes sure that the extra removed connections will be grouped in the same undo action
+    transaction.finishRemove();  // Makes sure that the extra removed connections will be grouped in the same undo action
+
+    patch.performTransaction(std::move(transaction));
 
     deselectAll();
 
@@ -1232,6 +1251,8 @@ void Canvas::removeSelection()
 
 void Canvas::undo()
 {
+    pd->storeExtraInfo();
+
     // Tell pd to undo the last action
     patch.undo();
 
@@ -1243,6 +1264,8 @@ void Canvas::undo()
 
 void Canvas::redo()
 {
+    pd->storeExtraInfo();
+
     // Tell pd to undo the last action
     patch.redo();
 
@@ -1327,6 +1350,36 @@ void Canvas::hideSuggestions()
     suggestor->currentBox = nullptr;
 }
 
+void Canvas::showProfile(std::vector<pd::Profiler::Load> const& loads)
+{
+    std::unordered_map<void*, float> loadPerObject;
+    float maxLoad = 0.0f;
+
+    for (auto& load : loads)
+    {
+        loadPerObject[load.object] = load.load;
+        maxLoad = std::max(maxLoad, load.load);
+    }
+
+    // Relative to the heaviest object, so the hot spots stand out at any total load
+    for (auto* box : boxes)
+    {
+        float heat = 0.0f;
+
+        if (box->pdObject && maxLoad > 0.0f)
+        {
+            auto it = loadPerObject.find(box->pdObject->getPointer());
+            if (it != loadPerObject.end()) heat = it->second / maxLoad;
+        }
+
+        if (std::abs(heat - box->profileHeat) > 0.01f)
+        {
+            box->profileHeat = heat;
+            box->repaint();
+        }
+    }
+}
+
 // Makes component selected
 void Canvas::setSelected(Component* component, bool shouldNowBeSelected)
 {
@@ -1389,7 +1442,9 @@ void Canvas::handleMouseUp(Component* component, const MouseEvent& e)
         }
 
         // When done dragging objects, update positions to pd
-        patch.moveObjects(objects, totalDragDelta.x, totalDragDelta.y);
+        pd::Patch::Transaction transaction;
+        transaction.moveObjects(objects, totalDragDelta.x, totalDragDelta.y);
+        patch.performTransaction(std::move(transaction));
 
         // Check if canvas is large enough
         checkBounds();
@@ -1442,7 +1497,7 @@ void Canvas::removeSelectedComponent(Component* component)
 
 void Canvas::findLassoItemsInArea(Array<Component*>& itemsFound, const Rectangle<int>& area)
 {
-    for (auto* element : boxes)
+    for (auto* element : boxGrid.findBoxes(area))
     {
         if (area.intersects(element->getBounds()))
         {
@@ -1450,31 +1505,23 @@ void Canvas::findLassoItemsInArea(Array<Component*>& itemsFound, const Rectangle
             setSelected(element, true);
             element->repaint();
         }
-        else if (!ModifierKeys::getCurrentModifiers().isAnyModifierKeyDown())
+    }
+
+    // Boxes outside of the area can only need deselecting if they are selected
+    if (!ModifierKeys::getCurrentModifiers().isAnyModifierKeyDown())
+    {
+        for (auto* box : getSelectionOfType<Box>())
         {
-            setSelected(element, false);
+            if (!area.intersects(box->getBounds())) setSelected(box, false);
         }
     }
 
     for (auto& con : connections)
     {
-        bool intersect = false;
-
-        // Check intersection with path
-        for (int i = 0; i < 200; i++)
-        {
-            float position = static_cast<float>(i) / 200.0f;
-            auto point = con->toDraw.getPointAlongPath(position * con->toDraw.getLength());
-
-            if (!point.isFinite()) continue;
-
-            if (lasso.getBounds().contains(point.toInt() + con->getPosition()))
-            {
-                intersect = true;
-            }
-        }
+        // Connections that don't overlap the lasso can be skipped without checking their path
+        if (!area.intersects(con->getBounds())) continue;
 
-        if (intersect)
+        if (con->intersectsRectangle(area.toFloat()))
         {
             con->repaint();
             itemsFound.add(con);
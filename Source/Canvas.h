@@ -9,6 +9,7 @@
 #include <JuceHeader.h>
 
 #include "Box.h"
+#include "BoxGrid.h"
 #include "Pd/PdPatch.h"
 #include "PluginProcessor.h"
 
@@ -51,6 +52,9 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Comp
     void pasteSelection();
     void duplicateSelection();
 
+    // Synchronises once after a transaction, and selects the boxes of the objects it created
+    void synchroniseAndSelect(std::vector<t_pd*> const& objects);
+
     void valueChanged(Value& v) override;
 
     void checkBounds();
@@ -84,6 +88,9 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Comp
 
     void showSuggestions(Box* box, TextEditor* editor);
     void hideSuggestions();
+
+    // Tints the boxes by their share of the dsp load, an empty profile clears the tints
+    void showProfile(std::vector<pd::Profiler::Load> const& loads);
     
     template <typename T>
     Array<T*> getSelectionOfType()
@@ -109,6 +116,9 @@ class Canvas : public Component, public Value::Listener, public LassoSource<Comp
 
     pd::Patch patch;
 
+    // Declared before the boxes, because boxes remove themselves from it when they get deleted
+    BoxGrid boxGrid;
+
     OwnedArray<Box> boxes;
     OwnedArray<Connection> connections;
 
@@ -51,11 +51,6 @@ Connection::Connection(Canvas* parent, Edge* s, Edge* e, bool exists) : cnv(pare
             return;
         }
     }
-    else
-    {
-        auto info = cnv->patch.getExtraInfo(getId());
-        if (!info.isEmpty()) setState(info);
-    }
 
     // Listen to changes at edges
     outlet->box->addComponentListener(this);
@@ -94,7 +89,7 @@ MemoryBlock Connection::getState()
 
 void Connection::setState(MemoryBlock& block)
 {
-    auto info = MemoryInputStream(cnv->patch.getExtraInfo(getId()));
+    auto info = MemoryInputStream(block, false);
 
     auto pathAsString = info.readString();
 
@@ -120,6 +115,17 @@ String Connection::getId() const
     return "c" + String(idx1) + String(idx2) + String(inIdx) + String(outIdx);
 }
 
+String Connection::getId(std::unordered_map<void*, size_t> const& objectIndex) const
+{
+    auto getIndex = [&objectIndex](Box* box)
+    {
+        auto it = objectIndex.find(box->pdObject->getPointer());
+        return it != objectIndex.end() ? static_cast<int>(it->second) : -1;
+    };
+
+    return "c" + String(getIndex(inlet->box)) + String(getIndex(outlet->box)) + String(inIdx) + String(outIdx);
+}
+
 Connection::~Connection()
 {
     if (outlet && outlet->box)
@@ -438,44 +444,99 @@ void Connection::updatePath()
     }
 
     offset = {-bounds.getX(), -bounds.getY()};
+
+    // Cache the flattened path, so selection tests don't need to walk the curves again
+    flattenedPath.clear();
+    for (PathFlatteningIterator it(toDraw); it.next();)
+    {
+        if (flattenedPath.empty()) flattenedPath.emplace_back(it.x1, it.y1);
+        flattenedPath.emplace_back(it.x2, it.y2);
+    }
 }
 
-void Connection::findPath()
+bool Connection::intersectsRectangle(Rectangle<float> area) const
 {
-    if (!outlet || !inlet) return;
+    auto toCheck = area - getPosition().toFloat();
 
-    auto pstart = inlet->getCanvasBounds().getCentre();
-    auto pend = outlet->getCanvasBounds().getCentre();
+    if (flattenedPath.empty() || !toCheck.intersects(toDraw.getBounds().expanded(1.0f))) return false;
 
-    auto pathStack = PathPlan();
-    auto bestPath = PathPlan();
+    // Clip each segment against the rectangle (Liang-Barsky)
+    auto segmentIntersects = [&toCheck](Point<float> start, Point<float> end)
+    {
+        auto delta = end - start;
+        float enter = 0.0f, exit = 1.0f;
 
-    pathStack.reserve(8);
+        auto clip = [&enter, &exit](float direction, float distance)
+        {
+            if (direction == 0.0f) return distance >= 0.0f;
 
-    auto numFound = 0;
-    auto resolution = 3;
+            auto t = distance / direction;
+            if (direction < 0.0f)
+            {
+                enter = std::max(enter, t);
+            }
+            else
+            {
+                exit = std::min(exit, t);
+            }
 
-    int incrementX, incrementY;
+            return enter <= exit;
+        };
+
+        return clip(-delta.x, start.x - toCheck.getX()) && clip(delta.x, toCheck.getRight() - start.x) && clip(-delta.y, start.y - toCheck.getY()) && clip(delta.y, toCheck.getBottom() - start.y);
+    };
 
-    auto distance = pend.getDistanceFrom(pstart);
-    auto bounds = Rectangle<int>(pstart, pend);
+    if (flattenedPath.size() == 1) return toCheck.contains(flattenedPath.front());
 
-    // Look for paths at an increasing resolution
-    while (!numFound && resolution < 7 && distance > 40)
+    for (size_t i = 1; i < flattenedPath.size(); i++)
     {
-        // Find paths on an resolution*resolution lattice grid
-        incrementX = std::max(abs(pstart.x - pend.x) / resolution, resolution);
-        incrementY = std::max(abs(pstart.y - pend.y) / resolution, resolution);
+        if (segmentIntersects(flattenedPath[i - 1], flattenedPath[i])) return true;
+    }
+
+    return false;
+}
+
+// Boxes near an area are the router's obstacles, drawn at the bounds of their graphics when they have any
+static void addObstacles(ConnectionRouter& router, Canvas* cnv, Rectangle<int> area)
+{
+    for (auto* box : cnv->boxGrid.findBoxes(area))
+    {
+        if (!box->isVisible()) continue;
 
-        numFound = findLatticePaths(bestPath, pathStack, pstart, pend, {incrementX, incrementY});
-        resolution++;
-        pathStack.clear();
+        auto bounds = box->getBounds();
+        if (auto* graphics = box->graphics.get()) bounds = graphics->getBounds() + box->getPosition();
+
+        router.addObstacle(box, bounds);
+    }
+}
+
+void Connection::findPath(ConnectionRouter const* router)
+{
+    if (!outlet || !inlet) return;
+
+    auto pstart = inlet->getCanvasBounds().getCentre();
+    auto pend = outlet->getCanvasBounds().getCentre();
+
+    auto bestPath = PathPlan();
+
+    if (pend.getDistanceFrom(pstart) > 40)
+    {
+        if (router)
+        {
+            bestPath = router->route(pstart, inlet->box, pend, outlet->box);
+        }
+        else
+        {
+            ConnectionRouter singleRouter;
+            addObstacles(singleRouter, cnv, ConnectionRouter::getRoutingArea(pstart, pend));
+            bestPath = singleRouter.route(pstart, inlet->box, pend, outlet->box);
+        }
     }
 
     PathPlan simplifiedPath;
 
     bool direction;
-    if (!bestPath.empty())
+    if (bestPath.size() >= 2)
     {
         simplifiedPath.push_back(bestPath.front());
 
@@ -527,119 +588,25 @@ void Connection::findPath()
     cnv->patch.setExtraInfo(lastId, state);
 }
 
-int Connection::findLatticePaths(PathPlan& bestPath, PathPlan& pathStack, Point<int> pstart, Point<int> pend, Point<int> increment)
+void Connection::findPaths(Canvas* cnv, Array<Connection*> const& toRoute)
 {
-    // Stop after we've found a path
-    if (!bestPath.empty()) return 0;
+    Rectangle<int> area;
 
-    // Add point to path
-    pathStack.push_back(pstart);
-
-    // Check if it intersects any box
-    if (pathStack.size() > 1 && straightLineIntersectsObject(Line<int>(pathStack.back(), *(pathStack.end() - 2))))
+    for (auto* connection : toRoute)
     {
-        return 0;
-    }
-
-    bool endVertically = pathStack[0].y > pend.y;
-
-    // Check if we've reached the destination
-    if (abs(pstart.x - pend.x) < (increment.x * 0.5) && abs(pstart.y - pend.y) < (increment.y * 0.5))
-    {
-        bestPath = pathStack;
-        return 1;
-    }
-
-    // Count the number of found paths
-    int count = 0;
+        if (!connection->outlet || !connection->inlet) continue;
 
-    // Get current stack to revert to after each trial
-    auto pathCopy = pathStack;
-
-    auto followLine = [this, &count, &pathCopy, &bestPath, &pathStack, &increment](Point<int> outlet, Point<int> inlet, bool isX)
-    {
-        auto& coord1 = isX ? outlet.x : outlet.y;
-        auto& coord2 = isX ? inlet.x : inlet.y;
-        auto& incr = isX ? increment.x : increment.y;
-
-        if (abs(coord1 - coord2) >= incr)
-        {
-            coord1 > coord2 ? coord1 -= incr : coord1 += incr;
-            count += findLatticePaths(bestPath, pathStack, outlet, inlet, increment);
-            pathStack = pathCopy;
-        }
-    };
-
-    // If we're halfway on the axis, change preferred direction by inverting search order
-    // This will make it do a staircase effect
-    if (endVertically)
-    {
-        if (abs(pstart.y - pend.y) >= abs(pathStack[0].y - pend.y) * 0.5)
-        {
-            followLine(pstart, pend, false);
-            followLine(pstart, pend, true);
-        }
-        else
-        {
-            followLine(pstart, pend, true);
-            followLine(pstart, pend, false);
-        }
-    }
-    else
-    {
-        if (abs(pstart.x - pend.x) >= abs(pathStack[0].x - pend.x) * 0.5)
-        {
-            followLine(pstart, pend, true);
-            followLine(pstart, pend, false);
-        }
-        else
-        {
-            followLine(pstart, pend, false);
-            followLine(pstart, pend, true);
-        }
+        auto routingArea = ConnectionRouter::getRoutingArea(connection->inlet->getCanvasBounds().getCentre(), connection->outlet->getCanvasBounds().getCentre());
+        area = area.isEmpty() ? routingArea : area.getUnion(routingArea);
     }
 
-    return count;
-}
+    // Collect the obstacles once for the whole batch
+    ConnectionRouter router;
+    addObstacles(router, cnv, area);
 
-bool Connection::straightLineIntersectsObject(Line<int> toCheck)
-{
-    for (const auto& box : cnv->boxes)
+    for (auto* connection : toRoute)
     {
-        auto bounds = box->getBounds().expanded(3);
-
-        if (auto* graphics = box->graphics.get()) bounds = graphics->getBounds().expanded(3) + box->getPosition();
-
-        if (box == outlet->box || box == inlet->box || !bounds.intersects(getLocalBounds())) continue;
-
-        auto intersectV = [](Line<int> first, Line<int> second)
-        {
-            if (first.getStartY() > first.getEndY())
-            {
-                first = {first.getEnd(), first.getStart()};
-            }
-
-            return first.getStartX() > second.getStartX() && first.getStartX() < second.getEndX() && second.getStartY() > first.getStartY() && second.getStartY() < first.getEndY();
-        };
-
-        auto intersectH = [](Line<int> first, Line<int> second)
-        {
-            if (first.getStartX() > first.getEndX())
-            {
-                first = {first.getEnd(), first.getStart()};
-            }
-
-            return first.getStartY() > second.getStartY() && first.getStartY() < second.getEndY() && second.getStartX() > first.getStartX() && second.getStartX() < first.getEndX();
-        };
-
-        bool intersectsV = toCheck.isVertical() && (intersectV(toCheck, Line<int>(bounds.getTopLeft(), bounds.getTopRight())) || intersectV(toCheck, Line<int>(bounds.getBottomRight(), bounds.getBottomLeft())));
-
-        bool intersectsH = toCheck.isHorizontal() && (intersectH(toCheck, Line<int>(bounds.getTopRight(), bounds.getBottomRight())) || intersectH(toCheck, Line<int>(bounds.getTopLeft(), bounds.getBottomLeft())));
-        if (intersectsV || intersectsH)
-        {
-            return true;
-        }
+        connection->findPath(&router);
+        connection->updatePath();
     }
-
-    return false;
 }
@@ -8,17 +8,20 @@
 
 #include <JuceHeader.h>
 
+#include <unordered_map>
+
 extern "C"
 {
 #include <m_pd.h>
 }
 
+#include "ConnectionRouter.h"
 #include "Edge.h"
 #include "Pd/PdObject.h"
 
-using PathPlan = std::vector<Point<int>>;
-
+class Box;
 class Canvas;
+
 class Connection : public Component, public ComponentListener
 {
    public:
@@ -30,6 +33,9 @@ class Connection : public Component, public ComponentListener
     PathPlan currentPlan;
     Path toDraw;
 
+    // Flattened version of toDraw, updated together with it
+    std::vector<Point<float>> flattenedPath;
+
     Value locked;
     Value connectionStyle;
 
@@ -52,6 +58,9 @@ class Connection : public Component, public ComponentListener
 
     bool hitTest(int x, int y) override;
 
+    // Checks if the drawn path crosses an area in canvas coordinates
+    bool intersectsRectangle(Rectangle<float> area) const;
+
     void mouseDown(const MouseEvent& e) override;
     void mouseMove(const MouseEvent& e) override;
     void mouseDrag(const MouseEvent& e) override;
@@ -62,17 +71,19 @@ class Connection : public Component, public ComponentListener
 
     String getId() const;
 
+    // Same as getId, but looks the objects up in an index built by the canvas instead of walking the patch
+    String getId(std::unordered_map<void*, size_t> const& objectIndex) const;
+
     MemoryBlock getState();
     void setState(MemoryBlock& block);
 
     void componentMovedOrResized(Component& component, bool wasMoved, bool wasResized) override;
 
     // Pathfinding
-    int findLatticePaths(PathPlan& bestPath, PathPlan& pathStack, Point<int> start, Point<int> end, Point<int> increment);
-
-    void findPath();
+    void findPath(ConnectionRouter const* router = nullptr);
 
-    bool straightLineIntersectsObject(Line<int> first);
+    // Reroutes a batch of connections, sharing the obstacles between them
+    static void findPaths(Canvas* cnv, Array<Connection*> const& toRoute);
 
    private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Connection)
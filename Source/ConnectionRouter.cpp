@@ -0,0 +1,187 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+#include "ConnectionRouter.h"
+
+#include <limits>
+#include <queue>
+
+void ConnectionRouter::addObstacle(Box* box, Rectangle<int> bounds)
+{
+    obstacles.push_back({box, bounds.expanded(clearance)});
+}
+
+Rectangle<int> ConnectionRouter::getRoutingArea(Point<int> start, Point<int> end)
+{
+    return Rectangle<int>(start, end).expanded(searchMargin);
+}
+
+PathPlan ConnectionRouter::route(Point<int> inletPos, Box* inletBox, Point<int> outletPos, Box* outletBox) const
+{
+    auto area = getRoutingArea(inletPos, outletPos);
+
+    // The boxes we connect are obstacles too, but cut off at the inlet and outlet so the cord can leave them vertically
+    std::vector<Rectangle<int>> blocking;
+    for (auto& [box, bounds] : obstacles)
+    {
+        if (!bounds.intersects(area)) continue;
+
+        auto top = box == inletBox ? inletPos.y : bounds.getY();
+        auto bottom = box == outletBox ? outletPos.y : bounds.getBottom();
+
+        if (bottom > top) blocking.push_back(Rectangle<int>::leftTopRightBottom(bounds.getX(), top, bounds.getRight(), bottom));
+    }
+
+    // Nodes lie on the lines along the obstacle edges and through both end points
+    std::vector<int> xs = {inletPos.x, outletPos.x};
+    std::vector<int> ys = {inletPos.y, outletPos.y};
+
+    for (auto& rect : blocking)
+    {
+        xs.push_back(rect.getX());
+        xs.push_back(rect.getRight());
+        ys.push_back(rect.getY());
+        ys.push_back(rect.getBottom());
+    }
+
+    std::sort(xs.begin(), xs.end());
+    xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    int const width = static_cast<int>(xs.size());
+    int const height = static_cast<int>(ys.size());
+    int const numNodes = width * height;
+
+    auto getColumn = [&xs](int x) { return static_cast<int>(std::lower_bound(xs.begin(), xs.end(), x) - xs.begin()); };
+    auto getRow = [&ys](int y) { return static_cast<int>(std::lower_bound(ys.begin(), ys.end(), y) - ys.begin()); };
+
+    // Mark nodes inside obstacles, and edges to the right of and below a node that cross an obstacle
+    std::vector<uint8> blockedNode(numNodes, 0), blockedRight(numNodes, 0), blockedDown(numNodes, 0);
+
+    for (auto& rect : blocking)
+    {
+        int const firstColumn = static_cast<int>(std::upper_bound(xs.begin(), xs.end(), rect.getX()) - xs.begin());
+        int const lastColumn = getColumn(rect.getRight());
+        int const firstRow = static_cast<int>(std::upper_bound(ys.begin(), ys.end(), rect.getY()) - ys.begin());
+        int const lastRow = getRow(rect.getBottom());
+
+        for (int row = firstRow; row < lastRow; row++)
+        {
+            for (int column = std::max(firstColumn - 1, 0); column < std::min(lastColumn, width - 1); column++)
+            {
+                blockedRight[row * width + column] = 1;
+            }
+            for (int column = firstColumn; column < lastColumn; column++)
+            {
+                blockedNode[row * width + column] = 1;
+            }
+        }
+
+        for (int column = firstColumn; column < lastColumn; column++)
+        {
+            for (int row = std::max(firstRow - 1, 0); row < std::min(lastRow, height - 1); row++)
+            {
+                blockedDown[row * width + column] = 1;
+            }
+        }
+    }
+
+    int const startNode = getRow(inletPos.y) * width + getColumn(inletPos.x);
+    int const endNode = getRow(outletPos.y) * width + getColumn(outletPos.x);
+
+    blockedNode[startNode] = 0;
+    blockedNode[endNode] = 0;
+
+    // A* over (node, direction of the last segment) states, with an extra goal state
+    // that charges a bend when the cord would arrive at the outlet horizontally
+    enum Direction
+    {
+        Horizontal = 0,
+        Vertical = 1
+    };
+
+    int const goalState = numNodes * 2;
+    std::vector<int> cost(goalState + 1, std::numeric_limits<int>::max());
+    std::vector<int> previous(goalState + 1, -1);
+
+    auto estimate = [&](int node) { return std::abs(xs[node % width] - outletPos.x) + std::abs(ys[node / width] - outletPos.y); };
+
+    using QueueEntry = std::pair<int, int>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    auto relax = [&](int state, int newCost, int from)
+    {
+        if (newCost >= cost[state]) return;
+
+        cost[state] = newCost;
+        previous[state] = from;
+        queue.push({newCost + (state == goalState ? 0 : estimate(state / 2)), state});
+    };
+
+    // Cords leave the inlet upwards
+    relax(startNode * 2 + Vertical, 0, -1);
+
+    while (!queue.empty())
+    {
+        auto [priority, state] = queue.top();
+        queue.pop();
+
+        if (state == goalState) break;
+
+        int const node = state / 2;
+        int const direction = state % 2;
+
+        if (priority - estimate(node) > cost[state]) continue;
+
+        if (node == endNode)
+        {
+            relax(goalState, cost[state] + (direction == Horizontal ? bendPenalty : 0), state);
+            continue;
+        }
+
+        int const column = node % width;
+        int const row = node / width;
+
+        auto tryStep = [&](int next, bool blocked, int newDirection)
+        {
+            if (blocked || blockedNode[next]) return;
+
+            int const length = std::abs(xs[next % width] - xs[column]) + std::abs(ys[next / width] - ys[row]);
+            relax(next * 2 + newDirection, cost[state] + length + (newDirection != direction ? bendPenalty : 0), state);
+        };
+
+        if (column + 1 < width) tryStep(node + 1, blockedRight[node], Horizontal);
+        if (column > 0) tryStep(node - 1, blockedRight[node - 1], Horizontal);
+        if (row + 1 < height) tryStep(node + width, blockedDown[node], Vertical);
+        if (row > 0) tryStep(node - width, blockedDown[node - width], Vertical);
+    }
+
+    if (previous[goalState] < 0) return {};
+
+    // Walk back from the outlet and only keep the corners
+    PathPlan path;
+    for (int state = previous[goalState]; state >= 0; state = previous[state])
+    {
+        auto point = Point<int>(xs[(state / 2) % width], ys[(state / 2) / width]);
+
+        if (path.size() >= 2)
+        {
+            auto& last = path.back();
+            auto& beforeLast = path[path.size() - 2];
+
+            if ((last.x == beforeLast.x && last.x == point.x) || (last.y == beforeLast.y && last.y == point.y))
+            {
+                last = point;
+                continue;
+            }
+        }
+
+        path.push_back(point);
+    }
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,39 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <vector>
+
+using PathPlan = std::vector<Point<int>>;
+
+// Boxes are only used to recognise the ones being connected, so the router doesn't need the canvas
+class Box;
+
+// Orthogonal connection router
+// Runs A* over the grid formed by the edges of nearby boxes, with a penalty for every bend
+// Obstacles are collected once, so a single router can be reused to route a batch of connections
+class ConnectionRouter
+{
+   public:
+    // Adds a box to route around, with some clearance around its bounds
+    void addObstacle(Box* box, Rectangle<int> bounds);
+
+    // Returns the corners of the cheapest path from the inlet to the outlet, or an empty plan if there is none
+    PathPlan route(Point<int> inletPos, Box* inletBox, Point<int> outletPos, Box* outletBox) const;
+
+    // Area that needs to be searched to connect two points
+    static Rectangle<int> getRoutingArea(Point<int> start, Point<int> end);
+
+   private:
+    static inline constexpr int clearance = 8;
+    static inline constexpr int searchMargin = 150;
+    static inline constexpr int bendPenalty = 40;
+
+    std::vector<std::pair<Box*, Rectangle<int>>> obstacles;
+};
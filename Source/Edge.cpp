@@ -156,9 +156,9 @@ void Edge::createConnection()
 
 Edge* Edge::findNearestEdge(Canvas* cnv, Point<int> position, bool inlet, Box* boxToExclude)
 {
-    // Find all edges
+    // Find all edges on boxes within range
     Array<Edge*> allEdges;
-    for (auto* box : cnv->boxes)
+    for (auto* box : cnv->boxGrid.findBoxes(Rectangle<int>(position, position).expanded(150, 150)))
     {
         for (auto* edge : box->edges)
         {
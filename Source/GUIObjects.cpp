@@ -72,6 +72,9 @@ GUIComponent::GUIComponent(pd::Gui pdGui, Box* parent, bool newObject) : box(par
     
     sendSymbol = gui.getSendSymbol();
     receiveSymbol = gui.getReceiveSymbol();
+
+    symbolGui = processor.generateSymbol("gui");
+    symbolMouse = processor.generateSymbol("mouse");
     
     setWantsKeyboardFocus(true);
     
@@ -328,7 +331,7 @@ void GUIComponent::setValueScaled(float v)
 void GUIComponent::startEdition() noexcept
 {
     edited = true;
-    processor.enqueueMessages(stringGui, stringMouse, {1.f});
+    processor.enqueueMessages(symbolGui, symbolMouse, {1.f});
     
     value = gui.getValue();
 }
@@ -336,7 +339,7 @@ void GUIComponent::startEdition() noexcept
 void GUIComponent::stopEdition() noexcept
 {
     edited = false;
-    processor.enqueueMessages(stringGui, stringMouse, {0.f});
+    processor.enqueueMessages(symbolGui, symbolMouse, {0.f});
 }
 
 void GUIComponent::updateValue()
@@ -344,24 +347,30 @@ void GUIComponent::updateValue()
     if (!edited)
     {
         auto thisPtr = SafePointer<GUIComponent>(this);
+        auto pdGui = gui;
         box->cnv->pd->enqueueFunction(
-                                      [thisPtr]()
+                                      [thisPtr, pdGui]()
                                       {
-                                          float const v = thisPtr->gui.getValue();
+                                          float const v = pdGui.getValue();
                                           
                                           MessageManager::callAsync(
                                                                     [thisPtr, v]() mutable
                                                                     {
-                                                                        if (thisPtr && v != thisPtr->value)
-                                                                        {
-                                                                            thisPtr->value = v;
-                                                                            thisPtr->update();
-                                                                        }
+                                                                        if (thisPtr) thisPtr->receiveValue(v);
                                                                     });
                                       });
     }
 }
 
+void GUIComponent::receiveValue(float v)
+{
+    if (!edited && v != value)
+    {
+        value = v;
+        update();
+    }
+}
+
 void GUIComponent::componentMovedOrResized(Component& component, bool moved, bool resized)
 {
     updateLabel();
@@ -975,6 +984,11 @@ struct MessageComponent : public GUIComponent
         g.drawRoundedRectangle(getLocalBounds().toFloat(), 2.0f, 1.5f);
     }
     
+    bool pollsValue() const override
+    {
+        return false;
+    }
+    
     void updateValue() override
     {
         if (!edited)
@@ -1646,10 +1660,11 @@ public:
         if (graph.getName().empty()) return;
         
         vec.reserve(8192);
-        temp.reserve(8192);
         try
         {
-            array.read(vec);
+            std::pair<size_t, size_t> changed;
+            array.readChanges(vec, generation, changed);
+            peaks.rebuild(vec);
         }
         catch (...)
         {
@@ -1672,7 +1687,25 @@ public:
         {
             const auto h = static_cast<float>(getHeight());
             const auto w = static_cast<float>(getWidth());
-            if (!vec.empty())
+
+            // With more than two values per pixel, draw the range of each pixel column
+            if (vec.size() > static_cast<size_t>(getWidth()) * 2)
+            {
+                const std::array<float, 2> scale = array.getScale();
+                const float dh = h / (scale[1] - scale[0]);
+                const size_t width = std::max(getWidth(), 1);
+                g.setColour(findColour(ComboBox::outlineColourId));
+                for (size_t x = 0; x < width; x++)
+                {
+                    const size_t start = x * vec.size() / width;
+                    const size_t end = std::max(start + 1, (x + 1) * vec.size() / width);
+                    const auto [min, max] = peaks.getRange(vec, start, end);
+                    const float top = h - (std::clamp(max, scale[0], scale[1]) - scale[0]) * dh;
+                    const float bottom = h - (std::clamp(min, scale[0], scale[1]) - scale[0]) * dh;
+                    g.drawVerticalLine(static_cast<int>(x), top, std::max(bottom, top + 1.0f));
+                }
+            }
+            else if (!vec.empty())
             {
                 const std::array<float, 2> scale = array.getScale();
                 if (array.isDrawingCurve())
@@ -1766,6 +1799,7 @@ public:
         {
             vec[n] = jmap<float>(n, interpStart, interpEnd + 1, min, max);
         }
+        peaks.update(vec, interpStart, interpEnd + 1);
         
         // Don't want to touch vec on the other thread, so we copy the vector into the lambda
         auto changed = std::vector<float>(vec.begin() + interpStart, vec.begin() + interpEnd);
@@ -1805,17 +1839,22 @@ public:
             error = false;
             try
             {
-                array.read(temp);
+                // Only copies the range that pd changed since the last read
+                const auto size = vec.size();
+                std::pair<size_t, size_t> changed;
+                if (array.readChanges(vec, generation, changed))
+                {
+                    if (vec.size() != size)
+                        peaks.rebuild(vec);
+                    else
+                        peaks.update(vec, changed.first, changed.second);
+                    repaint();
+                }
             }
             catch (...)
             {
                 error = true;
             }
-            if (temp != vec)
-            {
-                vec.swap(temp);
-                repaint();
-            }
         }
     }
     
@@ -1826,7 +1865,8 @@ public:
     
     pd::Array array;
     std::vector<float> vec;
-    std::vector<float> temp;
+    unsigned int generation = 0;
+    pd::ArrayPeaks peaks;
     std::atomic<bool> edited;
     bool error = false;
     const std::string stringArray = std::string("array");
@@ -1943,6 +1983,11 @@ public:
         canvas->setBounds(-b.getX(), -b.getY(), b.getWidth() + b.getX(), b.getHeight() + b.getY());
     }
     
+    bool pollsValue() const override
+    {
+        return false;
+    }
+    
     void updateValue() override
     {
         updateCanvas();
@@ -1991,6 +2036,11 @@ struct Subpatch : public GUIComponent
         subpatch = gui.getPatch();
     }
     
+    bool pollsValue() const override
+    {
+        return false;
+    }
+    
     void updateValue() override
     {
         // Pd sometimes sets the isgraph flag too late...
@@ -2123,6 +2173,11 @@ struct VUMeter : public GUIComponent
         
     }
     
+    bool pollsValue() const override
+    {
+        return false;
+    }
+    
     void updateValue() override
     {
         auto rms = gui.getValue();
@@ -2152,6 +2207,11 @@ struct PanelComponent : public GUIComponent
         g.fillAll(Colour::fromString(secondaryColour.toString()));
     }
     
+    bool pollsValue() const override
+    {
+        return false;
+    }
+    
     void updateValue() override{};
     
     ObjectParameters getParameters() override
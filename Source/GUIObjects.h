@@ -31,6 +31,15 @@ struct GUIComponent : public Component, public ComponentListener, public Value::
 
     virtual void updateValue();
 
+    // Objects that read a float value from pd in updateValue are refreshed in batches by the editor instead
+    virtual bool pollsValue() const
+    {
+        return true;
+    }
+
+    // Applies a value that was read from pd, unless the user is editing
+    void receiveValue(float v);
+
     virtual void update(){};
 
     void initialise(bool newObject);
@@ -84,8 +93,9 @@ struct GUIComponent : public Component, public ComponentListener, public Value::
    protected:
     bool inspectorWasVisible = false;
 
-    const std::string stringGui = std::string("gui");
-    const std::string stringMouse = std::string("mouse");
+    // Interned once, so editing doesn't intern them again for every send
+    t_symbol* symbolGui = nullptr;
+    t_symbol* symbolMouse = nullptr;
 
     static inline constexpr int maxSize = 1000000;
 
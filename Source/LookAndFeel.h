@@ -44,6 +44,8 @@ struct Icons
     inline static const CharPointer_UTF8 Message = CharPointer_UTF8("\xef\x81\xb5");
 
     inline static const CharPointer_UTF8 Presentation = CharPointer_UTF8("\xef\x81\xab");
+    inline static const CharPointer_UTF8 Profiler = CharPointer_UTF8("\xef\x83\xa4");
+    inline static const CharPointer_UTF8 Parallel = CharPointer_UTF8("\xef\x83\xa8");
 
     inline static const CharPointer_UTF8 Pin = CharPointer_UTF8("\xef\x82\x8d");
 
@@ -6,6 +6,8 @@
 
 #include "PdArray.h"
 
+#include <stdexcept>
+
 extern "C"
 {
 #include "x_libpd_extra_utils.h"
@@ -57,6 +59,37 @@ void Array::read(std::vector<float>& output) const
     libpd_read_array(output.data(), name.c_str(), 0, size);
 }
 
+bool Array::readChanges(std::vector<float>& output, unsigned int& generation, std::pair<size_t, size_t>& changed) const
+{
+    int size = 0, start = 0, end = 0;
+    libpd_set_instance(static_cast<t_pdinstance*>(instance));
+    auto const current = libpd_array_get_changes(name.c_str(), generation, &size, &start, &end);
+    if (size < 0)
+    {
+        throw std::runtime_error("array " + name + " doesn't exist");
+    }
+
+    bool const resized = static_cast<size_t>(size) != output.size();
+    if (resized)
+    {
+        output.resize(static_cast<size_t>(size));
+        start = 0;
+        end = size;
+    }
+    else if (current == generation)
+    {
+        return false;
+    }
+
+    generation = current;
+    changed = {static_cast<size_t>(start), static_cast<size_t>(end)};
+    if (end > start)
+    {
+        libpd_read_array(output.data() + start, name.c_str(), start, end - start);
+    }
+    return true;
+}
+
 void Array::write(std::vector<float> const& input)
 {
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
@@ -5,9 +5,12 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace pd
@@ -44,6 +47,12 @@ class Array
     //! @brief Gets the values of the array.
     void read(std::vector<float>& output) const;
 
+    //! @brief Gets the values that changed since a generation of the array.
+    //! @details Only the changed range is copied, unless the size of the array changed.\n
+    //! The generation is updated, use 0 for a first read. The copied index range is returned in changed.\n
+    //! Returns false if nothing changed.
+    bool readChanges(std::vector<float>& output, unsigned int& generation, std::pair<size_t, size_t>& changed) const;
+
     //! @brief Writes the values of the array.
     void write(std::vector<float> const& input);
 
@@ -57,4 +66,95 @@ class Array
     friend class Instance;
     friend class Gui;
 };
+
+//! @brief Min/max pyramid of an array's values.
+//! @details Lets the array be drawn at a cost that depends on the width instead of the array size.
+class ArrayPeaks
+{
+   public:
+    using Range = std::pair<float, float>;
+
+    //! @brief Number of samples summarised by a bucket of the first level.
+    //! @details Every next level halves the number of buckets.
+    static constexpr size_t bucketSize = 16;
+
+    //! @brief Sizes the levels for the data and summarises all of it.
+    void rebuild(std::vector<float> const& data)
+    {
+        levels.clear();
+        size_t numBuckets = (data.size() + bucketSize - 1) / bucketSize;
+        while (numBuckets > 0)
+        {
+            levels.emplace_back(numBuckets);
+            if (numBuckets == 1) break;
+            numBuckets = (numBuckets + 1) / 2;
+        }
+        update(data, 0, data.size());
+    }
+
+    //! @brief Updates the buckets that cover the samples in [start, end).
+    void update(std::vector<float> const& data, size_t start, size_t end)
+    {
+        if (levels.empty() || start >= end) return;
+
+        size_t lo = start / bucketSize;
+        size_t hi = (std::min(end, data.size()) + bucketSize - 1) / bucketSize;
+
+        for (size_t i = lo; i < hi; i++)
+        {
+            auto const first = data.begin() + i * bucketSize;
+            auto const last = data.begin() + std::min((i + 1) * bucketSize, data.size());
+            auto const [min, max] = std::minmax_element(first, last);
+            levels[0][i] = {*min, *max};
+        }
+
+        for (size_t level = 1; level < levels.size(); level++)
+        {
+            auto const& below = levels[level - 1];
+            lo /= 2;
+            hi = (hi + 1) / 2;
+            for (size_t i = lo; i < hi; i++)
+            {
+                auto range = below[i * 2];
+                if (i * 2 + 1 < below.size()) range = combine(range, below[i * 2 + 1]);
+                levels[level][i] = range;
+            }
+        }
+    }
+
+    //! @brief Gets the minimum and maximum of the samples in [start, end).
+    Range getRange(std::vector<float> const& data, size_t start, size_t end) const
+    {
+        Range result = {std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+        end = std::min(end, data.size());
+
+        // Samples outside of whole buckets are read directly
+        auto lo = (start + bucketSize - 1) / bucketSize;
+        auto hi = end / bucketSize;
+        if (levels.empty() || lo >= hi)
+        {
+            for (size_t i = start; i < end; i++) result = combine(result, {data[i], data[i]});
+            return result;
+        }
+        for (size_t i = start; i < lo * bucketSize; i++) result = combine(result, {data[i], data[i]});
+        for (size_t i = hi * bucketSize; i < end; i++) result = combine(result, {data[i], data[i]});
+
+        // Whole buckets are combined from the coarsest levels that fit
+        for (size_t level = 0; lo < hi; level++, lo /= 2, hi /= 2)
+        {
+            if (lo & 1) result = combine(result, levels[level][lo++]);
+            if (hi & 1) result = combine(result, levels[level][--hi]);
+        }
+
+        return result;
+    }
+
+   private:
+    static Range combine(Range a, Range b)
+    {
+        return {std::min(a.first, b.first), std::max(a.second, b.second)};
+    }
+
+    std::vector<std::vector<Range>> levels;
+};
 }  // namespace pd
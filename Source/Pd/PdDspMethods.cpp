@@ -0,0 +1,152 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+
+#include "PdDspMethods.h"
+
+namespace pd
+{
+
+// A slot is only claimed, changed and released by its own instance with that instance locked, so a lookup from
+// the same instance never races with it. Lookups from other instances only compare the instance.
+struct DspMethodsSlot
+{
+    std::atomic<t_pdinstance*> instance = nullptr;
+    std::atomic<DspMethods::Method> wrapper = nullptr;
+    std::atomic<DspMethods*> methods = nullptr;
+};
+
+static constexpr int maxSlots = 256;
+static std::array<DspMethodsSlot, maxSlots> slots;
+
+// The slot of the previous lookup, which is nearly always the one we need while a chain is built
+static thread_local int lastSlot = 0;
+
+DspMethods::DspMethods(void* ownerToUse, Method wrapperToUse) : owner(ownerToUse), wrapper(wrapperToUse)
+{
+}
+
+DspMethods::~DspMethods()
+{
+    // The instance has to be locked to put the methods back, which only the owner can do
+    jassert(!isAttached());
+}
+
+bool DspMethods::attach()
+{
+    if (isAttached()) return true;
+
+    for (int i = 0; i < maxSlots; i++)
+    {
+        t_pdinstance* expected = nullptr;
+        if (slots[i].instance.compare_exchange_strong(expected, pd_this, std::memory_order_acq_rel))
+        {
+            slots[i].wrapper.store(wrapper, std::memory_order_relaxed);
+            slots[i].methods.store(this, std::memory_order_relaxed);
+
+            slot = i;
+            instance = pd_this;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DspMethods::detach()
+{
+    if (!isAttached()) return;
+
+    jassert(instance == pd_this);
+
+    for (auto& [cls, original] : originals)
+    {
+        if (auto* method = findMethod(cls, gensym("dsp")))
+        {
+            method->me_fun = original;
+        }
+    }
+
+    originals.clear();
+
+    slots[slot].methods.store(nullptr, std::memory_order_relaxed);
+    slots[slot].wrapper.store(nullptr, std::memory_order_relaxed);
+    slots[slot].instance.store(nullptr, std::memory_order_release);
+
+    slot = -1;
+    instance = nullptr;
+}
+
+bool DspMethods::wrap(t_class* cls)
+{
+    if (!isAttached() || isWrapped(cls)) return false;
+
+    auto* method = findMethod(cls, gensym("dsp"));
+    if (!method) return false;
+
+    originals.emplace(cls, method->me_fun);
+    method->me_fun = reinterpret_cast<t_gotfn>(wrapper);
+
+    return true;
+}
+
+bool DspMethods::isWrapped(t_class* cls) const
+{
+    return originals.find(cls) != originals.end();
+}
+
+void DspMethods::callOriginal(t_object* object, t_signal** signals) const
+{
+    auto it = originals.find(pd_class(&object->ob_pd));
+
+    jassert(it != originals.end());
+    if (it == originals.end()) return;
+
+    reinterpret_cast<Method>(it->second)(object, signals);
+}
+
+DspMethods* DspMethods::find(Method wrapperToFind)
+{
+    auto matches = [wrapperToFind](DspMethodsSlot const& candidate)
+    { return candidate.instance.load(std::memory_order_acquire) == pd_this && candidate.wrapper.load(std::memory_order_relaxed) == wrapperToFind; };
+
+    if (matches(slots[lastSlot])) return slots[lastSlot].methods.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < maxSlots; i++)
+    {
+        if (matches(slots[i]))
+        {
+            lastSlot = i;
+            return slots[i].methods.load(std::memory_order_relaxed);
+        }
+    }
+
+    return nullptr;
+}
+
+t_methodentry* DspMethods::findMethod(t_class* cls, t_symbol* name)
+{
+    t_methodentry* methods;
+
+#if PDINSTANCE
+    methods = cls->c_methods[pd_this->pd_instanceno];
+#else
+    methods = cls->c_methods;
+#endif
+
+    for (int i = 0; i < cls->c_nmethod; i++)
+    {
+        if (methods[i].me_name == name) return methods + i;
+    }
+
+    return nullptr;
+}
+
+}  // namespace pd
@@ -0,0 +1,73 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+extern "C"
+{
+#include <m_pd.h>
+#include <m_imp.h>
+}
+
+namespace pd
+{
+//! @brief Swaps the "dsp" method of classes in the method table of one instance.
+//! @details Every instance has its own method tables, so a swapped method only takes effect in the instance it was
+//! swapped in. The swapped-in method is shared by all instances though, it looks up the DspMethods of the instance
+//! it is called in with find(), which doesn't lock or allocate.\n
+//! Everything except find() is called with the instance locked.
+class DspMethods
+{
+   public:
+    using Method = void (*)(t_object*, t_signal**);
+
+    DspMethods(void* owner, Method wrapper);
+    ~DspMethods();
+
+    //! @brief Makes find() return this object in the current instance, returns false if there is no room left.
+    bool attach();
+
+    //! @brief Puts the original methods back and stops find() from returning this object.
+    void detach();
+
+    bool isAttached() const noexcept
+    {
+        return slot >= 0;
+    }
+
+    //! @brief Swaps the dsp method of a class, returns false if the class has none or it was swapped already.
+    bool wrap(t_class* cls);
+
+    bool isWrapped(t_class* cls) const;
+
+    //! @brief Calls the dsp method an object's class had before it was swapped.
+    void callOriginal(t_object* object, t_signal** signals) const;
+
+    template <typename Owner>
+    Owner* getOwner() const noexcept
+    {
+        return static_cast<Owner*>(owner);
+    }
+
+    //! @brief Finds the DspMethods that swapped in a method in the current instance, called from that method while the chain is built.
+    static DspMethods* find(Method wrapper);
+
+    //! @brief Finds a method of a class in the method table of the current instance.
+    static t_methodentry* findMethod(t_class* cls, t_symbol* name);
+
+   private:
+    void* const owner;
+    Method const wrapper;
+
+    int slot = -1;
+    t_pdinstance* instance = nullptr;
+
+    // The methods we swapped out, by class
+    std::unordered_map<t_class*, t_gotfn> originals;
+};
+}  // namespace pd
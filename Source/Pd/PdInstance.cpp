@@ -5,9 +5,13 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <unordered_set>
+#include <vector>
 
 extern "C"
 {
+#include <g_canvas.h>
 #include <g_undo.h>
 #include <m_imp.h>
 
@@ -23,87 +27,100 @@ extern "C"
 {
     struct pd::Instance::internal
     {
-        static void instance_multi_bang(pd::Instance* ptr, const char* recv)
+        static void instance_multi_bang(pd::Instance* ptr, t_symbol* recv)
         {
-            ptr->enqueueFunction([ptr, recv]() { ptr->processMessage({std::string("bang"), std::string(recv)}); });
+            Message message;
+            message.selector = Message::Bang;
+            message.destination = recv;
+            ptr->enqueueReceived(message);
         }
 
-        static void instance_multi_float(pd::Instance* ptr, const char* recv, float f)
+        static void instance_multi_float(pd::Instance* ptr, t_symbol* recv, float f)
         {
-            ptr->enqueueFunction([ptr, recv, f]() mutable { ptr->processMessage({std::string("float"), std::string(recv), std::vector<Atom>(1, {f})}); });
+            Message message;
+            message.selector = Message::Float;
+            message.destination = recv;
+            message.argc = 1;
+            SETFLOAT(message.atoms, f);
+            ptr->enqueueReceived(message);
         }
 
-        static void instance_multi_symbol(pd::Instance* ptr, const char* recv, const char* sym)
+        static void instance_multi_symbol(pd::Instance* ptr, t_symbol* recv, t_symbol* sym)
         {
-            ptr->enqueueFunction([ptr, recv, sym]() mutable { ptr->processMessage({std::string("symbol"), std::string(recv), std::vector<Atom>(1, std::string(sym))}); });
+            Message message;
+            message.selector = Message::Symbol;
+            message.destination = recv;
+            message.argc = 1;
+            SETSYMBOL(message.atoms, sym);
+            ptr->enqueueReceived(message);
         }
 
-        static void instance_multi_list(pd::Instance* ptr, const char* recv, int argc, t_atom* argv)
+        static void instance_multi_list(pd::Instance* ptr, t_symbol* recv, int argc, t_atom* argv)
         {
-            Message mess{std::string("list"), std::string(recv), std::vector<Atom>(argc)};
-            for (int i = 0; i < argc; ++i)
-            {
-                if (argv[i].a_type == A_FLOAT)
-                    mess.list[i] = Atom(atom_getfloat(argv + i));
-                else if (argv[i].a_type == A_SYMBOL)
-                    mess.list[i] = Atom(std::string(atom_getsymbol(argv + i)->s_name));
-            }
+            Message message;
+            message.selector = Message::List;
+            message.destination = recv;
+            if (ptr->fillMessage(message, argc, argv)) ptr->enqueueReceived(message);
+        }
 
-            ptr->enqueueFunction([ptr, mess]() mutable { ptr->processMessage(std::move(mess)); });
+        static void instance_multi_message(pd::Instance* ptr, t_symbol* recv, t_symbol* msg, int argc, t_atom* argv)
+        {
+            Message message;
+            message.selector = Message::Anything;
+            message.destination = recv;
+            message.message = msg;
+            if (ptr->fillMessage(message, argc, argv)) ptr->enqueueReceived(message);
         }
 
-        static void instance_multi_message(pd::Instance* ptr, const char* recv, const char* msg, int argc, t_atom* argv)
+        static void instance_multi_midi(pd::Instance* ptr, Message::Selector selector, int midi1, int midi2, int midi3)
         {
-            Message mess{msg, std::string(recv), std::vector<Atom>(argc)};
-            for (int i = 0; i < argc; ++i)
-            {
-                if (argv[i].a_type == A_FLOAT)
-                    mess.list[i] = Atom(atom_getfloat(argv + i));
-                else if (argv[i].a_type == A_SYMBOL)
-                    mess.list[i] = Atom(std::string(atom_getsymbol(argv + i)->s_name));
-            }
-            ptr->enqueueFunction([ptr, mess]() mutable { ptr->processMessage(std::move(mess)); });
+            Message message;
+            message.selector = selector;
+            message.midi[0] = midi1;
+            message.midi[1] = midi2;
+            message.midi[2] = midi3;
+            message.offset = ptr->getMidiTimestamp();
+            ptr->enqueueReceived(message);
         }
 
         static void instance_multi_noteon(pd::Instance* ptr, int channel, int pitch, int velocity)
         {
-            ptr->enqueueFunction([ptr, channel, pitch, velocity]() mutable { ptr->processMidiEvent({midievent::NOTEON, channel, pitch, velocity}); });
+            instance_multi_midi(ptr, Message::NoteOn, channel, pitch, velocity);
         }
 
         static void instance_multi_controlchange(pd::Instance* ptr, int channel, int controller, int value)
         {
-            ptr->enqueueFunction([ptr, channel, controller, value]() mutable { ptr->processMidiEvent({midievent::CONTROLCHANGE, channel, controller, value}); });
+            instance_multi_midi(ptr, Message::ControlChange, channel, controller, value);
         }
 
         static void instance_multi_programchange(pd::Instance* ptr, int channel, int value)
         {
-            ptr->enqueueFunction([ptr, channel, value]() mutable { ptr->processMidiEvent({midievent::PROGRAMCHANGE, channel, value, 0}); });
+            instance_multi_midi(ptr, Message::ProgramChange, channel, value, 0);
         }
 
         static void instance_multi_pitchbend(pd::Instance* ptr, int channel, int value)
         {
-            ptr->enqueueFunction([ptr, channel, value]() mutable { ptr->processMidiEvent({midievent::PROGRAMCHANGE, channel, value, 0}); });
+            instance_multi_midi(ptr, Message::PitchBend, channel, value, 0);
         }
 
         static void instance_multi_aftertouch(pd::Instance* ptr, int channel, int value)
         {
-            ptr->enqueueFunction([ptr, channel, value]() mutable { ptr->processMidiEvent({midievent::AFTERTOUCH, channel, value, 0}); });
+            instance_multi_midi(ptr, Message::AfterTouch, channel, value, 0);
         }
 
         static void instance_multi_polyaftertouch(pd::Instance* ptr, int channel, int pitch, int value)
         {
-            ptr->enqueueFunction([ptr, channel, pitch, value]() mutable { ptr->processMidiEvent({midievent::POLYAFTERTOUCH, channel, pitch, value}); });
+            instance_multi_midi(ptr, Message::PolyAfterTouch, channel, pitch, value);
         }
 
         static void instance_multi_midibyte(pd::Instance* ptr, int port, int byte)
         {
-            ptr->enqueueFunction([ptr, port, byte]() mutable { ptr->processMidiEvent({midievent::MIDIBYTE, port, byte, 0}); });
+            instance_multi_midi(ptr, Message::MidiByte, port, byte, 0);
         }
 
         static void instance_multi_print(pd::Instance* ptr, char const* s)
         {
-            auto message = std::string(s);
-            ptr->enqueueFunction([ptr, message]() mutable { ptr->processPrint(message); });
+            ptr->enqueuePrint(s);
         }
     };
 }
@@ -124,8 +141,8 @@ Instance::Instance(std::string const& symbol)
                              reinterpret_cast<t_libpd_multi_midibytehook>(internal::instance_multi_midibyte));
     m_print_receiver = libpd_multi_print_new(this, reinterpret_cast<t_libpd_multi_printhook>(internal::instance_multi_print));
 
-    m_message_receiver = libpd_multi_receiver_new(this, symbol.c_str(), reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
-                                                  reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+    // The instance's own receiver is a subscription like any other, its listener calls the receive callbacks
+    m_message_receiver = subscribe(symbol, &m_receive_forwarder);
     m_atoms = malloc(sizeof(t_atom) * 512);
 
     // Register callback when pd's gui changes
@@ -135,15 +152,9 @@ Instance::Instance(std::string const& symbol)
     {
         auto* pd = static_cast<t_pd*>(target);
 
-        // redraw scalar
-        if (pd && !strcmp((*pd)->c_name->s_name, "scalar"))
-        {
-            static_cast<Instance*>(instance)->receiveGuiUpdate(2);
-        }
-        else
-        {
-            static_cast<Instance*>(instance)->receiveGuiUpdate(1);
-        }
+        // Scalars are redrawn through their templates, everything else by refreshing its value
+        bool isScalar = pd && !strcmp((*pd)->c_name->s_name, "scalar");
+        static_cast<Instance*>(instance)->enqueueGuiUpdate(target, isScalar);
     };
 
     auto panel_trigger = [](void* instance, int open, const char* snd, const char* location) { static_cast<Instance*>(instance)->createPanel(open, snd, location); };
@@ -152,7 +163,12 @@ Instance::Instance(std::string const& symbol)
         static_cast<Instance*>(instance)->synchroniseCanvas(cnv);
     };
 
-    register_gui_triggers(static_cast<t_pdinstance*>(m_instance), this, gui_trigger, panel_trigger, synchronise_trigger);
+    // A new canvas can get the address of a freed one, so its extra info has to go with it
+    auto canvasfree_trigger = [](void* instance, void* cnv) {
+        static_cast<Instance*>(instance)->m_freed_canvases.enqueue(cnv);
+    };
+
+    register_gui_triggers(static_cast<t_pdinstance*>(m_instance), this, gui_trigger, panel_trigger, synchronise_trigger, canvasfree_trigger);
 
     libpd_set_verbose(0);
 
@@ -163,11 +179,20 @@ Instance::~Instance()
 {
     closePatch();
 
-    pd_free(static_cast<t_pd*>(m_message_receiver));
+    for (auto& [symbol, subscription] : m_subscriptions)
+    {
+        pd_free(static_cast<t_pd*>(subscription.receiver));
+    }
     pd_free(static_cast<t_pd*>(m_midi_receiver));
     pd_free(static_cast<t_pd*>(m_print_receiver));
 
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+
+    sys_lock();
+    m_profiler.setEnabled(false);
+    m_parallel_dsp.setEnabled(false);
+    sys_unlock();
+
     libpd_free_instance(static_cast<t_pdinstance*>(m_instance));
 }
 
@@ -176,6 +201,25 @@ int Instance::getBlockSize() const noexcept
     return libpd_blocksize();
 }
 
+void Instance::setParallelDspEnabled(bool enabled)
+{
+    m_parallel = enabled;
+
+    if (enabled) m_parallel_dsp.startWorkers();
+
+    // Swapping the methods rebuilds the chain, which needs the same lock as the tick itself
+    setThis();
+
+    sys_lock();
+    if (!m_profiler.isEnabled()) m_parallel_dsp.setEnabled(enabled);
+    sys_unlock();
+}
+
+bool Instance::isParallelDspEnabled() const noexcept
+{
+    return m_parallel;
+}
+
 void Instance::prepareDSP(const int nins, const int nouts, const double samplerate)
 {
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
@@ -203,6 +247,47 @@ void Instance::performDSP(float const* inputs, float* outputs)
     libpd_process_raw(inputs, outputs);
 }
 
+void Instance::performDSP(float const** inputs, float** outputs, int numTicks)
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    libpd_process_channels(numTicks, inputs, outputs);
+}
+
+void Instance::setProfilingEnabled(bool enabled)
+{
+    m_profiling = enabled;
+
+    // Swapping the methods rebuilds the chain, which needs the same lock as the tick itself
+    setThis();
+
+    sys_lock();
+
+    // The profiler's timers share their state between routines, so the chain runs on one thread while profiling
+    if (enabled) m_parallel_dsp.setEnabled(false);
+    m_profiler.setEnabled(enabled);
+    if (!enabled) m_parallel_dsp.setEnabled(m_parallel);
+
+    sys_unlock();
+}
+
+bool Instance::isProfilingEnabled() const noexcept
+{
+    return m_profiling;
+}
+
+std::vector<Profiler::Load> Instance::getProfile()
+{
+    if (!m_profiling) return {};
+
+    setThis();
+
+    sys_lock();
+    m_profiler.update();
+    sys_unlock();
+
+    return m_profiler.getLoads();
+}
+
 void Instance::sendNoteOn(const int channel, const int pitch, const int velocity) const
 {
     libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
@@ -257,6 +342,50 @@ void Instance::sendMidiByte(const int port, const int byte) const
     libpd_midibyte(port, byte);
 }
 
+void Instance::setMidiTimeReference(int numSamples)
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    m_midi_reference = clock_getlogicaltime();
+    m_midi_reference_length = std::max(numSamples, 1);
+}
+
+void Instance::scheduleMidiMessage(int offset, const uint8_t* data, int size) const
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    libpd_multi_schedule_midi(m_midi_receiver, 0, std::max(offset, 0), size, data);
+}
+
+void Instance::sendList(t_symbol* receiver, float value) const
+{
+    if (!m_instance) return;
+
+    libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
+    sys_lock();
+    if (receiver->s_thing)
+    {
+        t_atom av;
+        SETFLOAT(&av, value);
+        pd_list(receiver->s_thing, &s_list, 1, &av);
+    }
+    sys_unlock();
+}
+
+t_symbol* Instance::generateSymbol(const String& symbol)
+{
+    setThis();
+    sys_lock();
+    auto* sym = gensym(symbol.toRawUTF8());
+    sys_unlock();
+    return sym;
+}
+
+int Instance::getMidiTimestamp() const
+{
+    // Logical time is set to the time of the clock that caused the output, so this is sub-tick accurate
+    auto const offset = static_cast<int>(clock_gettimesincewithunits(m_midi_reference, 1, 1));
+    return std::clamp(offset, 0, m_midi_reference_length - 1);
+}
+
 void Instance::sendBang(const char* receiver) const
 {
     if (!m_instance) return;
@@ -313,125 +442,551 @@ void Instance::sendMessage(const char* receiver, const char* msg, const std::vec
     libpd_message(receiver, msg, static_cast<int>(list.size()), argv);
 }
 
-void Instance::processMessage(Message mess)
+void Instance::processMessage(Message& message)
+{
+    auto* argv = getAtoms(message);
+
+    m_midi_offset = message.offset;
+
+    if (dispatchToListeners(message, argv))
+    {
+        releaseMessage(message);
+        return;
+    }
+
+    // Messages to receivers are all delivered through subscriptions, what's left is midi
+    switch (message.selector)
+    {
+        case Message::NoteOn:
+            receiveNoteOn(message.midi[0] + 1, message.midi[1], message.midi[2]);
+            break;
+        case Message::ControlChange:
+            receiveControlChange(message.midi[0] + 1, message.midi[1], message.midi[2]);
+            break;
+        case Message::ProgramChange:
+            receiveProgramChange(message.midi[0] + 1, message.midi[1]);
+            break;
+        case Message::PitchBend:
+            receivePitchBend(message.midi[0] + 1, message.midi[1]);
+            break;
+        case Message::AfterTouch:
+            receiveAftertouch(message.midi[0] + 1, message.midi[1]);
+            break;
+        case Message::PolyAfterTouch:
+            receivePolyAftertouch(message.midi[0] + 1, message.midi[1], message.midi[2]);
+            break;
+        case Message::MidiByte:
+            receiveMidiByte(message.midi[0], message.midi[1]);
+            break;
+        default:
+            break;
+    }
+
+    releaseMessage(message);
+}
+
+bool Instance::dispatchToListeners(Message& message, t_atom* argv)
+{
+    if (!message.destination || message.selector > Message::Anything) return false;
+
+    auto subscription = m_subscriptions.find(message.destination);
+    if (subscription == m_subscriptions.end()) return false;
+
+    t_symbol* selector = message.message;
+    switch (message.selector)
+    {
+        case Message::Bang:
+            selector = &s_bang;
+            break;
+        case Message::Float:
+            selector = &s_float;
+            break;
+        case Message::Symbol:
+            selector = &s_symbol;
+            break;
+        case Message::List:
+            selector = &s_list;
+            break;
+        default:
+            break;
+    }
+
+    for (auto* listener : subscription->second.listeners)
+    {
+        listener->receiveMessage(message.destination, selector, message.argc, argv);
+    }
+
+    return true;
+}
+
+void Instance::ReceiveForwarder::receiveMessage(t_symbol* receiver, t_symbol* selector, int argc, t_atom* argv)
 {
-    if (mess.selector == "bang")
-        receiveBang(mess.destination);
-    else if (mess.selector == "float")
-        receiveFloat(mess.destination, mess.list[0].getFloat());
-    else if (mess.selector == "symbol")
-        receiveSymbol(mess.destination, mess.list[0].getSymbol());
-    else if (mess.selector == "list")
-        receiveList(mess.destination, mess.list);
+    auto* dest = receiver->s_name;
+
+    if (selector == &s_bang)
+        instance.receiveBang(dest);
+    else if (selector == &s_float && argc > 0)
+        instance.receiveFloat(dest, atom_getfloat(argv));
+    else if (selector == &s_symbol && argc > 0)
+        instance.receiveSymbol(dest, atom_getsymbol(argv)->s_name);
+    else if (selector == &s_list)
+        instance.receiveList(dest, argc, argv);
     else
-        receiveMessage(mess.destination, mess.selector, mess.list);
+        instance.receiveMessage(dest, selector->s_name, argc, argv);
 }
 
-void Instance::processMidiEvent(midievent event)
+t_symbol* Instance::subscribe(const String& receiver, MessageListener* listener)
 {
-    if (event.type == midievent::NOTEON)
-        receiveNoteOn(event.midi1 + 1, event.midi2, event.midi3);
-    else if (event.type == midievent::CONTROLCHANGE)
-        receiveControlChange(event.midi1 + 1, event.midi2, event.midi3);
-    else if (event.type == midievent::PROGRAMCHANGE)
-        receiveProgramChange(event.midi1 + 1, event.midi2);
-    else if (event.type == midievent::PITCHBEND)
-        receivePitchBend(event.midi1 + 1, event.midi2);
-    else if (event.type == midievent::AFTERTOUCH)
-        receiveAftertouch(event.midi1 + 1, event.midi2);
-    else if (event.type == midievent::POLYAFTERTOUCH)
-        receivePolyAftertouch(event.midi1 + 1, event.midi2, event.midi3);
-    else if (event.type == midievent::MIDIBYTE)
-        receiveMidiByte(event.midi1, event.midi2);
+    auto* symbol = generateSymbol(receiver);
+
+    const CriticalSection* cs = getCallbackLock();
+    if (cs) cs->enter();
+
+    auto& subscription = m_subscriptions[symbol];
+    if (!subscription.receiver)
+    {
+        setThis();
+        subscription.receiver = libpd_multi_receiver_new(this, symbol->s_name, reinterpret_cast<t_libpd_multi_banghook>(internal::instance_multi_bang), reinterpret_cast<t_libpd_multi_floathook>(internal::instance_multi_float), reinterpret_cast<t_libpd_multi_symbolhook>(internal::instance_multi_symbol),
+                                                         reinterpret_cast<t_libpd_multi_listhook>(internal::instance_multi_list), reinterpret_cast<t_libpd_multi_messagehook>(internal::instance_multi_message));
+    }
+    subscription.listeners.push_back(listener);
+
+    if (cs) cs->exit();
+
+    return symbol;
 }
 
-void Instance::processPrint(std::string print)
+void Instance::unsubscribe(t_symbol* receiver, MessageListener* listener)
 {
-    if (print.empty()) return;
+    const CriticalSection* cs = getCallbackLock();
+    if (cs) cs->enter();
 
-    while (!print.empty() && (print.back() == '\n' || print.back() == ' '))
+    auto subscription = m_subscriptions.find(receiver);
+    if (subscription != m_subscriptions.end())
     {
-        print.pop_back();
+        auto& listeners = subscription->second.listeners;
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+
+        if (listeners.empty())
+        {
+            setThis();
+            pd_free(static_cast<t_pd*>(subscription->second.receiver));
+            m_subscriptions.erase(subscription);
+        }
     }
 
-    MessageManager::callAsync([this, print]() mutable { receivePrint(print); });
+    if (cs) cs->exit();
+}
+
+void Instance::enqueuePrint(const char* message)
+{
+    auto length = static_cast<int>(strlen(message));
+    auto total = static_cast<int>(sizeof(int)) + length;
+
+    if (m_print_fifo.getFreeSpace() < total)
+    {
+        m_prints_dropped++;
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    m_print_fifo.prepareToWrite(total, start1, size1, start2, size2);
+
+    // Copies into the reserved region, which may wrap around the end of the buffer
+    auto put = [this, start1, size1, start2](const char* source, int size, int offset)
+    {
+        int first = jlimit(0, size, size1 - offset);
+        if (first > 0) memcpy(m_print_buffer.data() + start1 + offset, source, first);
+        if (size > first) memcpy(m_print_buffer.data() + start2 + offset + first - size1, source + first, size - first);
+    };
+
+    put(reinterpret_cast<const char*>(&length), sizeof(int), 0);
+    put(message, length, sizeof(int));
+
+    m_print_fifo.finishedWrite(size1 + size2);
 }
 
-void Instance::processSend(dmessage mess)
+void Instance::enqueueGuiUpdate(void* target, bool isScalar)
 {
-    if (mess.object && !mess.list.empty())
+    if (isScalar)
+    {
+        m_gui_update_scalars.store(true, std::memory_order_relaxed);
+    }
+    else if (!target)
     {
-        if (mess.selector == "list")
+        m_gui_update_all.store(true, std::memory_order_relaxed);
+    }
+    else
+    {
+        auto hash = (reinterpret_cast<size_t>(target) >> 4) * 2654435761u;
+        bool added = false;
+
+        for (int i = 0; i < maxGuiUpdateProbes && !added; i++)
         {
-            auto* argv = static_cast<t_atom*>(m_atoms);
-            for (size_t i = 0; i < mess.list.size(); ++i)
-            {
-                if (mess.list[i].isFloat())
-                    SETFLOAT(argv + i, mess.list[i].getFloat());
-                else if (mess.list[i].isSymbol())
-                {
-                    sys_lock();
-                    SETSYMBOL(argv + i, gensym(mess.list[i].getSymbol().data()));
-                    sys_unlock();
-                }
-                else
-                    SETFLOAT(argv + i, 0.0);
-            }
-            sys_lock();
-            pd_list(static_cast<t_pd*>(mess.object), gensym("list"), static_cast<int>(mess.list.size()), argv);
-            sys_unlock();
+            auto& slot = m_gui_updates[(hash + i) & (numGuiUpdateSlots - 1)];
+            void* current = slot.load(std::memory_order_relaxed);
+
+            // A failed exchange loads the current value, which may be the same target queued by another thread
+            added = (!current && slot.compare_exchange_strong(current, target)) || current == target;
         }
-        else if (mess.selector == "float" && mess.list[0].isFloat())
+
+        if (!added) m_gui_update_all.store(true, std::memory_order_relaxed);
+    }
+
+    m_gui_update_pending.store(true, std::memory_order_release);
+}
+
+void Instance::processGuiUpdates()
+{
+    if (!m_gui_update_pending.exchange(false, std::memory_order_acquire)) return;
+
+    m_gui_update_targets.clear();
+
+    for (auto& slot : m_gui_updates)
+    {
+        if (slot.load(std::memory_order_relaxed))
         {
-            sys_lock();
-            pd_float(static_cast<t_pd*>(mess.object), mess.list[0].getFloat());
-            sys_unlock();
+            if (auto* target = slot.exchange(nullptr)) m_gui_update_targets.push_back(target);
         }
-        else if (mess.selector == "symbol")
+    }
+
+    auto refreshAll = m_gui_update_all.exchange(false);
+    auto scalarsChanged = m_gui_update_scalars.exchange(false);
+
+    receiveGuiUpdates(m_gui_update_targets, refreshAll, scalarsChanged);
+}
+
+void Instance::processPrints()
+{
+    int numPrints = 0;
+    bool changed = false;
+
+    m_logging_batch = true;
+
+    while (m_print_fifo.getNumReady() >= static_cast<int>(sizeof(int)) && numPrints++ < maxPrintsPerBatch)
+    {
+        int start1, size1, start2, size2;
+
+        auto get = [this, &start1, &size1, &start2](char* destination, int size, int offset)
         {
-            sys_lock();
-            pd_symbol(static_cast<t_pd*>(mess.object), gensym(mess.list[0].getSymbol().c_str()));
-            sys_unlock();
+            int first = jlimit(0, size, size1 - offset);
+            if (first > 0) memcpy(destination, m_print_buffer.data() + start1 + offset, first);
+            if (size > first) memcpy(destination + first, m_print_buffer.data() + start2 + offset + first - size1, size - first);
+        };
+
+        int length = 0;
+        m_print_fifo.prepareToRead(sizeof(int), start1, size1, start2, size2);
+        get(reinterpret_cast<char*>(&length), sizeof(int), 0);
+
+        // Records are published as a whole, so the text is always ready after the length
+        auto total = static_cast<int>(sizeof(int)) + length;
+        m_print_fifo.prepareToRead(total, start1, size1, start2, size2);
+
+        std::string print(length, '\0');
+        get(print.data(), length, sizeof(int));
+
+        m_print_fifo.finishedRead(total);
+
+        while (!print.empty() && (print.back() == '\n' || print.back() == ' '))
+        {
+            print.pop_back();
+        }
+
+        if (print.empty()) continue;
+
+        auto position = consoleMessagesTrimmed + consoleMessages.size();
+
+        // Collapse a line that repeats the last one, as long as nothing was logged in between
+        if (!consoleMessages.empty() && position == m_last_print_position && m_last_print == String(print))
+        {
+            m_last_print_repeats++;
+            consoleMessages.back().first = m_last_print_text + " (x" + String(m_last_print_repeats) + ")";
+            changed = true;
+            continue;
+        }
+
+        receivePrint(print);
+
+        auto newPosition = consoleMessagesTrimmed + consoleMessages.size();
+
+        if (newPosition != position)
+        {
+            m_last_print = print;
+            m_last_print_text = consoleMessages.back().first;
+            m_last_print_repeats = 1;
+            m_last_print_position = newPosition;
+            changed = true;
         }
     }
-    else
+
+    m_logging_batch = false;
+
+    if (auto dropped = m_prints_dropped.exchange(0))
+    {
+        logError(String(dropped) + " messages were dropped because the console couldn't keep up");
+        changed = false;
+    }
+
+    if (changed) updateConsole();
+}
+
+void Instance::processSend(Message& message)
+{
+    auto* argv = getAtoms(message);
+
+    auto* target = message.object ? message.object : message.destination->s_thing;
+
+    if (target)
+    {
+        switch (message.selector)
+        {
+            case Message::Bang:
+                pd_bang(target);
+                break;
+            case Message::Float:
+                pd_float(target, atom_getfloat(argv));
+                break;
+            case Message::Symbol:
+                pd_symbol(target, atom_getsymbol(argv));
+                break;
+            case Message::List:
+                if (message.argc) pd_list(target, &s_list, message.argc, argv);
+                break;
+            case Message::Anything:
+                pd_typedmess(target, message.message, message.argc, argv);
+                break;
+            default:
+                break;
+        }
+    }
+
+    releaseMessage(message);
+}
+
+t_atom* Instance::reserveAtoms(Message& message, int argc)
+{
+    if (argc <= Message::numInlineAtoms) return message.atoms;
+
+    if (argc > AtomPool::blockSize) return nullptr;
+
+    message.overflow = m_atom_pool.acquire();
+
+    // Pool exhausted, drop the message rather than allocate
+    if (message.overflow < 0) return nullptr;
+
+    return m_atom_pool.getBlock(message.overflow);
+}
+
+bool Instance::fillMessage(Message& message, int argc, t_atom* argv)
+{
+    auto* atoms = reserveAtoms(message, argc);
+    if (!atoms) return false;
+
+    std::copy_n(argv, argc, atoms);
+    message.argc = argc;
+    return true;
+}
+
+bool Instance::fillMessage(Message& message, std::vector<Atom> const& list)
+{
+    auto const argc = static_cast<int>(list.size());
+    auto* atoms = reserveAtoms(message, argc);
+    if (!atoms) return false;
+
+    // Symbols are interned here, so the pd thread never has to
+    for (int i = 0; i < argc; ++i)
+    {
+        if (list[i].isFloat())
+            SETFLOAT(atoms + i, list[i].getFloat());
+        else
+            SETSYMBOL(atoms + i, gensym(list[i].getSymbol().c_str()));
+    }
+
+    message.argc = argc;
+    return true;
+}
+
+t_atom* Instance::getAtoms(Message& message)
+{
+    return message.overflow >= 0 ? m_atom_pool.getBlock(message.overflow) : message.atoms;
+}
+
+void Instance::releaseMessage(Message& message)
+{
+    if (message.overflow >= 0)
     {
-        sendMessage(mess.destination.c_str(), mess.selector.c_str(), mess.list);
+        m_atom_pool.release(message.overflow);
+        message.overflow = -1;
+    }
+}
+
+void Instance::enqueueReceived(Message& message)
+{
+    // Called from pd's thread: if the queue is full, the message is dropped instead of growing the queue
+    if (!m_receive_queue.try_enqueue(m_receive_token, message))
+    {
+        releaseMessage(message);
     }
 }
 
 void Instance::enqueueFunction(const std::function<void(void)>& fn)
 {
-    // This should be the way to do it, but it currently causes some issues
-    // By calling fn directly we fix these issues at the cost of possible thread unsafety
-    m_function_queue.enqueue(fn);
+    // Functions are only queued from the message thread, which may allocate
+    // They run on pd's thread with the instance unlocked, in submission order with the queued sends
+    m_function_queue.enqueue(QueuedFunction{m_send_sequence.fetch_add(1, std::memory_order_relaxed), fn});
+    messageEnqueued();
+}
+
+void Instance::enqueueSend(Message& message)
+{
+    // Sends and functions share one sequence, so they run in the order they were submitted
+    message.sequence = m_send_sequence.fetch_add(1, std::memory_order_relaxed);
+
+    if (!m_send_queue.try_enqueue(message))
+    {
+        releaseMessage(message);
+        return;
+    }
+
     messageEnqueued();
 }
 
 void Instance::enqueueMessages(const std::string& dest, const std::string& msg, std::vector<Atom>&& list)
 {
-    enqueueFunction([this, dest, msg, list]() mutable { processSend(dmessage{nullptr, dest, msg, std::move(list)}); });
+    Message message;
+    message.selector = Message::Anything;
+
+    setThis();
+    sys_lock();
+    message.destination = gensym(dest.c_str());
+    message.message = gensym(msg.c_str());
+    bool const filled = fillMessage(message, list);
+    sys_unlock();
+
+    if (filled) enqueueSend(message);
+}
+
+void Instance::enqueueMessages(t_symbol* dest, t_symbol* msg, std::vector<Atom>&& list)
+{
+    Message message;
+    message.selector = Message::Anything;
+    message.destination = dest;
+    message.message = msg;
+
+    // Only symbol arguments still need interning, and with that the lock
+    bool const hasSymbols = std::any_of(list.begin(), list.end(), [](Atom const& atom) { return atom.isSymbol(); });
+
+    bool filled;
+    if (hasSymbols)
+    {
+        setThis();
+        sys_lock();
+        filled = fillMessage(message, list);
+        sys_unlock();
+    }
+    else
+    {
+        filled = fillMessage(message, list);
+    }
+
+    if (filled) enqueueSend(message);
 }
 
 void Instance::enqueueDirectMessages(void* object, std::vector<Atom> const& list)
 {
-    enqueueFunction([this, object, list]() mutable { processSend(dmessage{object, std::string(), "list", list}); });
+    Message message;
+    message.selector = Message::List;
+    message.object = static_cast<t_pd*>(object);
+
+    setThis();
+    sys_lock();
+    bool const filled = fillMessage(message, list);
+    sys_unlock();
+
+    if (filled) enqueueSend(message);
 }
 
 void Instance::enqueueDirectMessages(void* object, const std::string& msg)
 {
-    enqueueFunction([this, object, msg]() mutable { processSend(dmessage{object, std::string(), "symbol", std::vector<Atom>(1, msg)}); });
+    Message message;
+    message.selector = Message::Symbol;
+    message.object = static_cast<t_pd*>(object);
+    message.argc = 1;
+
+    setThis();
+    sys_lock();
+    SETSYMBOL(message.atoms, gensym(msg.c_str()));
+    sys_unlock();
+
+    enqueueSend(message);
 }
 
 void Instance::enqueueDirectMessages(void* object, const float msg)
 {
-    enqueueFunction([this, object, msg]() mutable { processSend(dmessage{object, std::string(), "float", std::vector<Atom>(1, msg)}); });
+    Message message;
+    message.selector = Message::Float;
+    message.object = static_cast<t_pd*>(object);
+    message.argc = 1;
+    SETFLOAT(message.atoms, msg);
+
+    enqueueSend(message);
+}
+
+bool Instance::dequeueMessages()
+{
+    bool dequeued = false;
+
+    // Another instance may have been current on this thread
+    setThis();
+
+    QueuedFunction function;
+    bool hasFunction = m_function_queue.try_dequeue(function);
+
+    // Sends are dequeued in batches, so a run of sends only takes this instance's lock once
+    std::array<Message, 32> batch;
+    size_t count = 0;
+    size_t index = 0;
+
+    // Merge both queues by sequence number, so a send submitted before a function also runs before it
+    auto sendIsNext = [&]() { return index < count && (!hasFunction || batch[index].sequence < function.sequence); };
+
+    while (true)
+    {
+        if (index == count)
+        {
+            count = m_send_queue.try_dequeue_bulk(batch.begin(), batch.size());
+            index = 0;
+        }
+
+        if (sendIsNext())
+        {
+            sys_lock();
+            while (sendIsNext())
+            {
+                processSend(batch[index++]);
+            }
+            sys_unlock();
+        }
+        else if (hasFunction)
+        {
+            function.callback();
+            hasFunction = m_function_queue.try_dequeue(function);
+        }
+        else
+        {
+            break;
+        }
+
+        dequeued = true;
+    }
+
+    return dequeued;
 }
 
 void Instance::waitForStateUpdate()
 {
     // No action needed
-    if (m_function_queue.size_approx() == 0)
+    if (m_function_queue.size_approx() == 0 && m_send_queue.size_approx() == 0)
     {
         return;
     }
@@ -449,11 +1004,7 @@ void Instance::waitForStateUpdate()
     // Should ensure that patches are loaded correctly when audio hasn't started yet
     else
     {
-        std::function<void(void)> callback;
-        while (m_function_queue.try_dequeue(callback))
-        {
-            callback();
-        }
+        dequeueMessages();
     }
 }
 
@@ -461,12 +1012,16 @@ void Instance::sendMessagesFromQueue()
 {
     // libpd_set_instance(static_cast<t_pdinstance*>(m_instance));
 
-    std::function<void(void)> callback;
-    while (m_function_queue.try_dequeue(callback))
+    if (dequeueMessages())
     {
-        callback();
         audioStarted = true;
     }
+
+    Message message;
+    while (m_receive_queue.try_dequeue(message))
+    {
+        processMessage(message);
+    }
 }
 
 Patch Instance::openPatch(const File& toOpen)
@@ -494,6 +1049,8 @@ void Instance::savePatch(const File& location)
 
     auto* dir = gensym(fullPathname.toRawUTF8());
     auto* file = gensym(filename.toRawUTF8());
+
+    storeExtraInfo();
     libpd_savetofile(getPatch().getPointer(), file, dir);
 
     getPatch().setTitle(filename);
@@ -510,6 +1067,7 @@ void Instance::savePatch()
     auto* dir = gensym(fullPathname.toRawUTF8());
     auto* file = gensym(filename.toRawUTF8());
 
+    storeExtraInfo();
     libpd_savetofile(getPatch().getPointer(), file, dir);
 
     getPatch().setTitle(filename);
@@ -532,6 +1090,8 @@ void Instance::closePatch()
         libpd_closefile(m_patch);
         m_patch = nullptr;
     }
+
+    m_extra_info.clear();
 }
 
 Patch Instance::getPatch()
@@ -539,6 +1099,42 @@ Patch Instance::getPatch()
     return Patch(m_patch, this);
 }
 
+std::shared_ptr<ExtraInfo>& Instance::getExtraInfoStore(void* canvas)
+{
+    releaseFreedCanvases();
+    return m_extra_info[canvas];
+}
+
+void Instance::releaseFreedCanvases()
+{
+    void* cnv;
+    while (m_freed_canvases.try_dequeue(cnv))
+    {
+        m_extra_info.erase(cnv);
+    }
+}
+
+void Instance::storeExtraInfo()
+{
+    if (!m_patch) return;
+
+    // Hold pd's lock while we collect, so no canvas can get freed between pruning and collecting it
+    std::vector<void*> dirty;
+
+    getCallbackLock()->enter();
+    releaseFreedCanvases();
+    for (auto& [canvas, info] : m_extra_info)
+    {
+        if (info && info->dirty) dirty.push_back(canvas);
+    }
+    getCallbackLock()->exit();
+
+    for (auto* canvas : dirty)
+    {
+        Patch(canvas, this).storeExtraInfo();
+    }
+}
+
 Array Instance::getArray(std::string const& name)
 {
     return {name, m_instance};
@@ -609,12 +1205,28 @@ void Instance::createPanel(int type, const char* snd, const char* location)
 void Instance::logMessage(const String& message)
 {
     consoleMessages.emplace_back(message, 0);
-    updateConsole();
+    trimConsole();
+    if (!m_logging_batch) updateConsole();
 }
 
 void Instance::logError(const String& error)
 {
     consoleMessages.emplace_back(error, 1);
-    updateConsole();
+    trimConsole();
+    if (!m_logging_batch) updateConsole();
+}
+
+void Instance::trimConsole()
+{
+    while (consoleMessages.size() > consoleLimit)
+    {
+        consoleMessages.pop_front();
+        consoleMessagesTrimmed++;
+    }
+
+    while (consoleHistory.size() > consoleLimit)
+    {
+        consoleHistory.pop_front();
+    }
 }
 }  // namespace pd
@@ -9,8 +9,13 @@
 #include <JuceHeader.h>
 #include <z_libpd.h>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <map>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 extern "C"
 {
@@ -18,7 +23,9 @@ extern "C"
 }
 
 #include "PdAtom.h"
+#include "PdParallel.h"
 #include "PdPatch.h"
+#include "PdProfiler.h"
 #include "concurrentqueue.h"
 
 namespace pd
@@ -27,39 +34,92 @@ class Patch;
 
 class Instance
 {
+    //! @brief A fixed-size message record, passed between pd and the plugin without allocating.
+    //! @details Symbols are stored as interned pd symbols, so records can be copied freely.\n
+    //! Lists that don't fit in the inline storage borrow a block from the overflow pool.
     struct Message
     {
-        std::string selector;
-        std::string destination;
-        std::vector<Atom> list;
+        enum Selector : uint8_t
+        {
+            Bang,
+            Float,
+            Symbol,
+            List,
+            Anything,
+            NoteOn,
+            ControlChange,
+            ProgramChange,
+            PitchBend,
+            AfterTouch,
+            PolyAfterTouch,
+            MidiByte
+        };
+
+        static constexpr int numInlineAtoms = 8;
+
+        Selector selector = Bang;
+        t_symbol* destination = nullptr;
+        t_pd* object = nullptr;
+        t_symbol* message = nullptr;
+        int midi[3] = {0, 0, 0};
+        int offset = 0;
+        int argc = 0;
+        int overflow = -1;
+        uint64 sequence = 0;
+        t_atom atoms[numInlineAtoms];
     };
 
-    struct dmessage
+    //! @brief Preallocated atom storage for messages that exceed the inline size of a record.
+    //! @details Free blocks are the set bits of a mask, so both threads can take and return blocks without allocating.
+    class AtomPool
     {
-        void* object;
-        std::string destination;
-        std::string selector;
-        std::vector<Atom> list;
-    };
+       public:
+        static constexpr int numBlocks = 32;
+        static constexpr int blockSize = 512;
 
-    typedef struct midievent
-    {
-        enum
+        int acquire()
+        {
+            auto free = freeBlocks.load(std::memory_order_relaxed);
+
+            while (free != 0)
+            {
+                int block = 0;
+                while (!(free & (uint32(1) << block))) block++;
+
+                if (freeBlocks.compare_exchange_weak(free, free & ~(uint32(1) << block), std::memory_order_acquire)) return block;
+            }
+
+            return -1;
+        }
+
+        void release(int block)
+        {
+            freeBlocks.fetch_or(uint32(1) << block, std::memory_order_release);
+        }
+
+        t_atom* getBlock(int block)
         {
-            NOTEON,
-            CONTROLCHANGE,
-            PROGRAMCHANGE,
-            PITCHBEND,
-            AFTERTOUCH,
-            POLYAFTERTOUCH,
-            MIDIBYTE
-        } type;
-        int midi1;
-        int midi2;
-        int midi3;
-    } midievent;
+            return storage.data() + block * blockSize;
+        }
+
+       private:
+        static_assert(numBlocks <= 32, "The free blocks have to fit in the mask");
+
+        std::vector<t_atom> storage = std::vector<t_atom>(numBlocks * blockSize);
+        std::atomic<uint32> freeBlocks = ~uint32(0);
+    };
 
    public:
+    //! @brief Receives the messages that pd sends to a subscribed receiver.
+    class MessageListener
+    {
+       public:
+        virtual ~MessageListener() = default;
+
+        //! @brief Called with the interned receiver and selector, arguments are only valid during the call.
+        virtual void receiveMessage(t_symbol* receiver, t_symbol* selector, int argc, t_atom* argv) = 0;
+    };
+
     Instance(std::string const& symbol);
     Instance(Instance const& other) = delete;
     virtual ~Instance();
@@ -68,8 +128,22 @@ class Instance
     void startDSP();
     void releaseDSP();
     void performDSP(float const* inputs, float* outputs);
+    void performDSP(float const** inputs, float** outputs, int numTicks);
     int getBlockSize() const noexcept;
 
+    //! @brief Turns per-object dsp profiling on or off, from the message thread.
+    //! @details Enabling it times the perform routines of every object, disabling it rebuilds the dsp chain without the timers.
+    void setProfilingEnabled(bool enabled);
+    bool isProfilingEnabled() const noexcept;
+
+    //! @brief Returns the load of every profiled object since the previous call, from the message thread.
+    std::vector<Profiler::Load> getProfile();
+
+    //! @brief Turns running independent top-level subpatches and clones on worker threads on or off, from the message thread.
+    //! @details The mode is paused while profiling, which times the whole chain on the audio thread.
+    void setParallelDspEnabled(bool enabled);
+    bool isParallelDspEnabled() const noexcept;
+
     void sendNoteOn(const int channel, const int pitch, const int velocity) const;
     void sendControlChange(const int channel, const int controller, const int value) const;
     void sendProgramChange(const int channel, const int value) const;
@@ -80,6 +154,26 @@ class Instance
     void sendSysRealTime(const int port, const int byte) const;
     void sendMidiByte(const int port, const int byte) const;
 
+    //! @brief Makes the current logical time sample 0 for midi timestamps, until the next call.
+    //! @details Outgoing midi is stamped with its position in the next numSamples samples.
+    void setMidiTimeReference(int numSamples);
+
+    //! @brief Sends a short midi message (up to 3 bytes) into pd at a sample offset from the time reference.
+    //! @details The message is delivered from pd's clock, in between dsp ticks, at the logical time of that sample.
+    void scheduleMidiMessage(int offset, const uint8_t* data, int size) const;
+
+    //! @brief Sends a float as a list to an interned receiver, so the send needs no symbol lookup.
+    void sendList(t_symbol* receiver, float value) const;
+
+    //! @brief Interns a symbol in this instance, so it can be sent to without a lookup.
+    t_symbol* generateSymbol(const String& symbol);
+
+    //! @brief Sample offset from the time reference of the midi message currently being received.
+    int getMidiOffset() const noexcept
+    {
+        return m_midi_offset;
+    }
+
     virtual void receiveNoteOn(const int channel, const int pitch, const int velocity)
     {
     }
@@ -102,7 +196,9 @@ class Instance
     {
     }
 
-    virtual void receiveGuiUpdate(int type) {};
+    //! @brief Called on the message thread with the objects and canvases whose drawing changed in pd.
+    //! @details refreshAll is set when pd couldn't tell what changed, scalarsChanged when a scalar was redrawn.
+    virtual void receiveGuiUpdates(std::vector<void*> const& targets, bool refreshAll, bool scalarsChanged) {};
     virtual void synchroniseCanvas(void* cnv) {};
     
     virtual void createPanel(int type, const char* snd, const char* location);
@@ -115,22 +211,31 @@ class Instance
 
     virtual void receivePrint(const std::string& message){};
 
-    virtual void receiveBang(const std::string& dest)
+    // Called from the pd thread, arguments are only valid during the call
+    virtual void receiveBang(const char* dest)
     {
     }
-    virtual void receiveFloat(const std::string& dest, float num)
+    virtual void receiveFloat(const char* dest, float num)
     {
     }
-    virtual void receiveSymbol(const std::string& dest, const std::string& symbol)
+    virtual void receiveSymbol(const char* dest, const char* symbol)
     {
     }
-    virtual void receiveList(const std::string& dest, const std::vector<Atom>& list)
+    virtual void receiveList(const char* dest, int argc, t_atom* argv)
     {
     }
-    virtual void receiveMessage(const std::string& dest, const std::string& msg, const std::vector<Atom>& list)
+    virtual void receiveMessage(const char* dest, const char* msg, int argc, t_atom* argv)
     {
     }
 
+    //! @brief Binds a receiver in pd and sends what it receives to a listener.
+    //! @details Returns the interned receiver, which can be used as a handle. Messages are delivered
+    //! from sendMessagesFromQueue.
+    t_symbol* subscribe(const String& receiver, MessageListener* listener);
+
+    //! @brief Stops sending a receiver's messages to a listener, the receiver is unbound when it has no listeners left.
+    void unsubscribe(t_symbol* receiver, MessageListener* listener);
+
     virtual void updateConsole(){};
 
     virtual void titleChanged(){};
@@ -138,6 +243,9 @@ class Instance
     void enqueueFunction(const std::function<void(void)>& fn);
     void enqueueMessages(const std::string& dest, const std::string& msg, std::vector<Atom>&& list);
 
+    // Same as above with receivers interned by generateSymbol or subscribe, which skips interning them for every send
+    void enqueueMessages(t_symbol* dest, t_symbol* msg, std::vector<Atom>&& list);
+
     void enqueueDirectMessages(void* object, std::vector<Atom> const& list);
     void enqueueDirectMessages(void* object, const std::string& msg);
     void enqueueDirectMessages(void* object, const float msg);
@@ -148,10 +256,24 @@ class Instance
     virtual void messageEnqueued(){};
 
     void sendMessagesFromQueue();
-    void processMessage(Message mess);
-    void processPrint(std::string message);
-    void processMidiEvent(midievent event);
-    void processSend(dmessage mess);
+    void processMessage(Message& message);
+
+    //! @brief Writes a print from pd into the print ring, without locking or allocating.
+    //! @details Prints that don't fit are counted as dropped.
+    void enqueuePrint(const char* message);
+
+    //! @brief Drains the print ring on the message thread and logs the prints in one batch.
+    //! @details Repeated lines are collapsed into one console line with a repeat count.
+    void processPrints();
+
+    //! @brief Marks an object or canvas as changed from pd's thread, without locking or allocating.
+    //! @details A null target, or a full set, asks for a refresh of everything.
+    void enqueueGuiUpdate(void* target, bool isScalar);
+
+    //! @brief Drains the changed targets on the message thread and passes them to receiveGuiUpdates.
+    void processGuiUpdates();
+    // Called with the instance locked
+    void processSend(Message& message);
 
     Patch openPatch(const File& toOpen);
 
@@ -172,6 +294,12 @@ class Instance
     void closePatch();
     Patch getPatch();
 
+    // Extra info of every canvas we've wrapped in a Patch, empty until that canvas is first seen
+    std::shared_ptr<ExtraInfo>& getExtraInfoStore(void* canvas);
+
+    // Writes changed extra info into the plugdatainfo comments, call before pd serialises a canvas (save, copy, undo)
+    void storeExtraInfo();
+
     void setThis();
     Array getArray(std::string const& name);
 
@@ -189,7 +317,7 @@ class Instance
     void* m_instance = nullptr;
     void* m_patch = nullptr;
     void* m_atoms = nullptr;
-    void* m_message_receiver = nullptr;
+    t_symbol* m_message_receiver = nullptr;
     void* m_midi_receiver = nullptr;
     void* m_print_receiver = nullptr;
 
@@ -199,11 +327,115 @@ class Instance
 
     inline static const String defaultPatch = "#N canvas 827 239 527 327 12;";
 
-    std::vector<std::pair<String, int>> consoleMessages;
-    std::vector<std::pair<String, int>> consoleHistory;
+    // Console log, bounded so a patch that keeps printing can't grow it forever
+    std::deque<std::pair<String, int>> consoleMessages;
+    std::deque<std::pair<String, int>> consoleHistory;
+    size_t consoleLimit = 10000;
+
+    // Total number of messages trimmed from the front of consoleMessages, lets views keep their layout in sync
+    uint64 consoleMessagesTrimmed = 0;
+
+    void trimConsole();
 
    private:
-    moodycamel::ConcurrentQueue<std::function<void(void)>> m_function_queue = moodycamel::ConcurrentQueue<std::function<void(void)>>(4096);
+    std::unordered_map<void*, std::shared_ptr<ExtraInfo>> m_extra_info;
+
+    // Canvases pd has freed, their extra info is dropped before the store is used again
+    moodycamel::ConcurrentQueue<void*> m_freed_canvases = moodycamel::ConcurrentQueue<void*>(256);
+    void releaseFreedCanvases();
+
+    // Only touched with the instance locked, except for reading the loads
+    Profiler m_profiler;
+    std::atomic<bool> m_profiling = false;
+
+    t_atom* reserveAtoms(Message& message, int argc);
+    bool fillMessage(Message& message, std::vector<Atom> const& list);
+    bool fillMessage(Message& message, int argc, t_atom* argv);
+    t_atom* getAtoms(Message& message);
+    void releaseMessage(Message& message);
+
+    void enqueueReceived(Message& message);
+    bool dispatchToListeners(Message& message, t_atom* argv);
+    bool dequeueMessages();
+    int getMidiTimestamp() const;
+
+    struct QueuedFunction
+    {
+        uint64 sequence = 0;
+        std::function<void(void)> callback;
+    };
+
+    void enqueueSend(Message& message);
+
+    moodycamel::ConcurrentQueue<QueuedFunction> m_function_queue = moodycamel::ConcurrentQueue<QueuedFunction>(4096);
+
+    // Submission order of sends and functions, which travel through separate queues
+    std::atomic<uint64> m_send_sequence = 0;
+
+    // Typed message queues for the realtime traffic between pd and the plugin
+    // Sends are queued from the message thread, where allocating their implicit producers is fine
+    moodycamel::ConcurrentQueue<Message> m_send_queue = moodycamel::ConcurrentQueue<Message>(4096);
+    moodycamel::ConcurrentQueue<Message> m_receive_queue = moodycamel::ConcurrentQueue<Message>(4096);
+
+    // pd's thread only receives with the instance locked, so one explicit producer serves whichever thread runs pd
+    // Made up front, the first message received on the audio thread would otherwise allocate an implicit producer
+    moodycamel::ProducerToken m_receive_token{m_receive_queue};
+
+    AtomPool m_atom_pool;
+
+    // Prints are length prefixed records in a lock-free ring, drained on the message thread
+    static inline constexpr int printBufferSize = 1 << 16;
+    static inline constexpr int maxPrintsPerBatch = 512;
+
+    AbstractFifo m_print_fifo{printBufferSize};
+    std::vector<char> m_print_buffer = std::vector<char>(printBufferSize);
+    std::atomic<int> m_prints_dropped = 0;
+
+    String m_last_print;
+    String m_last_print_text;
+    int m_last_print_repeats = 0;
+    uint64 m_last_print_position = 0;
+    bool m_logging_batch = false;
+
+    // Changed gui targets, an open addressing set that pd's thread fills and the message thread drains
+    static inline constexpr int numGuiUpdateSlots = 1024;
+    static inline constexpr int maxGuiUpdateProbes = 16;
+
+    std::array<std::atomic<void*>, numGuiUpdateSlots> m_gui_updates = {};
+    std::atomic<bool> m_gui_update_pending = false;
+    std::atomic<bool> m_gui_update_all = false;
+    std::atomic<bool> m_gui_update_scalars = false;
+    std::vector<void*> m_gui_update_targets;
+
+    struct Subscription
+    {
+        void* receiver = nullptr;
+        std::vector<MessageListener*> listeners;
+    };
+
+    // Subscribed receivers, looked up by their interned symbol
+    std::unordered_map<t_symbol*, Subscription> m_subscriptions;
+
+    // Passes what the instance's own receiver gets on to the receive callbacks
+    struct ReceiveForwarder : public MessageListener
+    {
+        explicit ReceiveForwarder(Instance& parent) : instance(parent)
+        {
+        }
+
+        void receiveMessage(t_symbol* receiver, t_symbol* selector, int argc, t_atom* argv) override;
+
+        Instance& instance;
+    };
+
+    ReceiveForwarder m_receive_forwarder{*this};
+
+    double m_midi_reference = 0.0;
+    int m_midi_reference_length = 64;
+    int m_midi_offset = 0;
+
+    ParallelDsp m_parallel_dsp;
+    std::atomic<bool> m_parallel = false;
 
     File currentFile;
 
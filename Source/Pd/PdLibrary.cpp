@@ -24,196 +24,166 @@ struct _canvasenvironment
 namespace pd
 {
 
-// Iterative function to insert a key into a Trie
-void Trie::insert(const std::string& key)
+DocumentationIndex::DocumentationIndex() : Thread("Documentation Index")
 {
-    // Names with spaces not supported yet by the suggestor
-    if (std::count(key.begin(), key.end(), ' ')) return;
+    auto documentationRoot = File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory).getChildFile("PlugData").getChildFile("Documentation");
 
-    // start from the root node
-    Trie* curr = this;
-    for (char i : key)
-    {
-        // create a new node if the path doesn't exist
-        if (curr->character[i] == nullptr)
-        {
-            curr->character[i] = new Trie();
-        }
+    documentationDir = documentationRoot.getChildFile("pddoc");
+    indexFile = documentationRoot.getChildFile("pddoc.index");
+}
 
-        // go to the next node
-        curr = curr->character[i];
-    }
+DocumentationIndex::~DocumentationIndex()
+{
+    stopThread(5000);
+}
 
-    // mark the current node as a leaf
-    curr->isLeaf = true;
+void DocumentationIndex::load()
+{
+    if (!started.exchange(true)) startThread();
 }
 
-// Iterative function to search a key in a Trie. It returns true
-// if the key is found in the Trie; otherwise, it returns false
-bool Trie::search(const std::string& key)
+std::shared_ptr<const Documentation> DocumentationIndex::get() const
 {
-    Trie* curr = this;
-    for (char i : key)
+    return std::atomic_load(&documentation);
+}
+
+void DocumentationIndex::run()
+{
+    auto stamp = getDirectoryStamp();
+    auto result = readIndex(stamp);
+
+    if (!result)
     {
-        // go to the next node
-        curr = curr->character[i];
+        result = parseDocumentation();
 
-        // if the string is invalid (reached end of a path in the Trie)
-        if (curr == nullptr)
-        {
-            return false;
-        }
+        if (threadShouldExit()) return;
+
+        writeIndex(*result, stamp);
     }
 
-    // return true if the current node is a leaf and the
-    // end of the string is reached
-    return curr->isLeaf;
+    std::atomic_store(&documentation, std::shared_ptr<const Documentation>(std::move(result)));
 }
 
-// Returns true if a given node has any children
-bool Trie::hasChildren()
+// Adding, removing or renaming documentation changes the modification time of the directory it's in
+uint64 DocumentationIndex::getDirectoryStamp() const
 {
-    for (int i = 0; i < CHAR_SIZE; i++)
+    auto getDirectoryHash = [](File const& dir) { return static_cast<uint64>(dir.getFullPathName().hashCode64()) ^ static_cast<uint64>(dir.getLastModificationTime().toMilliseconds()); };
+
+    // Summed, so the order of the directory iterator doesn't matter
+    uint64 stamp = getDirectoryHash(documentationDir);
+
+    for (auto& iter : RangedDirectoryIterator(documentationDir, true, "*", File::findDirectories))
     {
-        if (character[i])
-        {
-            return true;  // child found
-        }
+        stamp += getDirectoryHash(iter.getFile());
     }
 
-    return false;
+    return stamp;
 }
 
-// Recursive function to delete a key in the Trie
-bool Trie::deletion(Trie*& curr, std::string key)
+std::shared_ptr<Documentation> DocumentationIndex::readIndex(uint64 stamp) const
 {
-    // return if Trie is empty
-    if (curr == nullptr)
-    {
-        return false;
-    }
+    MemoryMappedFile mappedFile(indexFile, MemoryMappedFile::readOnly);
 
-    // if the end of the key is not reached
-    if (key.length())
-    {
-        // recur for the node corresponding to the next character in the key
-        // and if it returns true, delete the current node (if it is non-leaf)
+    if (!mappedFile.getData()) return nullptr;
 
-        if (curr != nullptr && curr->character[key[0]] != nullptr && deletion(curr->character[key[0]], key.substr(1)) && !curr->isLeaf)
-        {
-            if (!curr->hasChildren())
-            {
-                delete curr;
-                curr = nullptr;
-                return true;
-            }
-            else
-            {
-                return false;
-            }
-        }
-    }
+    MemoryInputStream input(mappedFile.getData(), mappedFile.getSize(), false);
+
+    if (input.readInt() != indexMagic || input.readInt() != indexVersion || static_cast<uint64>(input.readInt64()) != stamp) return nullptr;
+
+    auto result = std::make_shared<Documentation>();
+
+    auto numObjects = input.readInt();
 
-    // if the end of the key is reached
-    if (key.length() == 0 && curr->isLeaf)
+    for (int i = 0; i < numObjects; i++)
     {
-        // if the current node is a leaf node and doesn't have any children
-        if (!curr->hasChildren())
-        {
-            // delete the current node
-            delete curr;
-            curr = nullptr;
+        auto name = input.readString();
+        result->descriptions[name] = input.readString();
 
-            // delete the non-leaf parent nodes
-            return true;
-        }
+        auto& keywords = result->keywords[name];
+        auto numKeywords = input.readInt();
 
-        // if the current node is a leaf node and has children
-        else
+        for (int j = 0; j < numKeywords; j++)
         {
-            // mark the current node as a non-leaf node (DON'T DELETE IT)
-            curr->isLeaf = false;
-
-            // don't delete its parent nodes
-            return false;
+            keywords.add(input.readString());
         }
+
+        // Truncated or corrupted index
+        if (input.isExhausted() && i < numObjects - 1) return nullptr;
     }
 
-    return false;
+    return result;
 }
 
-void Trie::suggestionsRec(std::string currPrefix, Suggestions& result)
+void DocumentationIndex::writeIndex(Documentation const& result, uint64 stamp) const
 {
-    // found aString in Trie with the given prefix
-    if (isLeaf)
+    // Write to a temporary file first, so other instances never see a partial index
+    TemporaryFile tempFile(indexFile);
+
     {
-        result.push_back({currPrefix, true});
-    }
+        FileOutputStream output(tempFile.getFile());
+        if (output.failedToOpen()) return;
 
-    // All children struct node pointers are NULL
-    if (!hasChildren()) return;
+        output.writeInt(indexMagic);
+        output.writeInt(indexVersion);
+        output.writeInt64(static_cast<int64>(stamp));
+        output.writeInt(static_cast<int>(result.descriptions.size()));
 
-    for (int i = 0; i < CHAR_SIZE; i++)
-    {
-        if (character[i])
+        for (auto& [name, description] : result.descriptions)
         {
-            // append current character to currPrefixString
-            currPrefix.push_back(i);
+            output.writeString(name);
+            output.writeString(description);
 
-            // recur over the rest
-            character[i]->suggestionsRec(currPrefix, result);
+            auto keywords = result.keywords.find(name);
+            auto numKeywords = keywords != result.keywords.end() ? keywords->second.size() : 0;
 
-            // remove last character
-            currPrefix.pop_back();
+            output.writeInt(numKeywords);
+            for (int i = 0; i < numKeywords; i++)
+            {
+                output.writeString(keywords->second[i]);
+            }
         }
+
+        output.flush();
+        if (output.getStatus().failed()) return;
     }
+
+    tempFile.overwriteTargetFileWithTemporary();
 }
 
-// print suggestions for given query prefix.
-int Trie::autocomplete(std::string query, Suggestions& result)
+std::shared_ptr<Documentation> DocumentationIndex::parseDocumentation() const
 {
-    auto* pCrawl = this;
-
-    // Check if prefix is present and find the
-    // the node (of last level) with last character
-    // of givenString.
-    int level;
-    int n = query.length();
-    for (level = 0; level < n; level++)
+    auto result = std::make_shared<Documentation>();
+
+    for (auto& iter : RangedDirectoryIterator(documentationDir, true))
     {
-        int index = CHAR_TO_INDEX(query[level]);
+        if (threadShouldExit()) break;
 
-        // noString in the Trie has this prefix
-        if (!pCrawl->character[index]) return 0;
+        auto file = iter.getFile();
 
-        pCrawl = pCrawl->character[index];
-    }
+        if (file.hasFileExtension("pddoc"))
+        {
+            XmlDocument doc(file);
 
-    // If prefix is present as a word.
-    bool isWord = pCrawl->isLeaf;
+            auto elt = doc.getDocumentElement();
+            if (!elt) continue;
 
-    // If prefix is last node of tree (has no
-    // children)
-    bool isLast = !pCrawl->hasChildren();
+            auto object = elt->getChildByName("object");
+            if (!object) continue;
 
-    // If prefix is present as a word, but
-    // there is no subtree below the last
-    // matching node.
-    if (isWord && isLast)
-    {
-        result.push_back({query, true});
-        return -1;
-    }
+            auto name = object->getStringAttribute("name");
 
-    // If there are are nodes below last
-    // matching character.
-    if (!isLast)
-    {
-        const std::string& prefix = query;
-        pCrawl->suggestionsRec(prefix, result);
-        return 1;
+            auto meta = object->getChildByName("meta");
+            if (!meta) continue;
+
+            auto keywords = meta->getChildElementAllSubText("keywords", "");
+            auto description = meta->getChildElementAllSubText("description", "");
+
+            result->descriptions[name] = description;
+            result->keywords[name] = StringArray::fromTokens(keywords, false);
+        }
     }
-    return 0;
+
+    return result;
 }
 
 void Library::initialiseLibrary()
@@ -224,9 +194,7 @@ void Library::initialiseLibrary()
 
     updateLibrary();
 
-    auto pddocPath = appDataDir.getChildFile("Documentation").getChildFile("pddoc").getFullPathName();
-
-    parseDocumentation(pddocPath);
+    documentation->load();
 
     startTimer(3000);
 }
@@ -237,7 +205,7 @@ void Library::updateLibrary()
 
     auto pathTree = settingsTree.getChildWithName("Paths");
 
-    searchTree = Trie();
+    std::vector<std::string> names;
 
     int i;
     t_class* o = pd_objectmaker;
@@ -252,57 +220,165 @@ void Library::updateLibrary()
     
     for (i = o->c_nmethod, m = mlist; i--; m++)
     {
-        String name(m->me_name->s_name);
-
-        searchTree.insert(m->me_name->s_name);
+        names.emplace_back(m->me_name->s_name);
     }
 
-    searchTree.insert("graph");
+    names.emplace_back("graph");
+
+    std::unordered_map<String, SearchPathContent> newSearchPathContents;
 
     for (auto path : pathTree)
     {
         auto filePath = File(path.getProperty("Path").toString());
+        auto lastModified = filePath.getLastModificationTime();
+
+        auto& content = newSearchPathContents[filePath.getFullPathName()];
+        auto cached = searchPathContents.find(filePath.getFullPathName());
 
-        for (auto& iter : RangedDirectoryIterator(filePath, false))
+        if (cached != searchPathContents.end() && cached->second.lastModified == lastModified)
         {
-            auto file = iter.getFile();
-            if (file.getFileExtension() == ".pd") searchTree.insert(file.getFileNameWithoutExtension().toStdString());
+            content = std::move(cached->second);
+        }
+        else
+        {
+            content.lastModified = lastModified;
+
+            for (auto& iter : RangedDirectoryIterator(filePath, false))
+            {
+                auto file = iter.getFile();
+                if (file.getFileExtension() == ".pd") content.names.push_back(file.getFileNameWithoutExtension().toStdString());
+            }
         }
+
+        names.insert(names.end(), content.names.begin(), content.names.end());
     }
+
+    searchPathContents = std::move(newSearchPathContents);
+
+    // Names with spaces not supported yet by the suggestor
+    names.erase(std::remove_if(names.begin(), names.end(), [](std::string const& name) { return name.empty() || name.find(' ') != std::string::npos; }), names.end());
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    objectNames = std::move(names);
 }
 
-void Library::parseDocumentation(const String& path)
+Suggestions Library::autocomplete(std::string query)
 {
-    for (auto& iter : RangedDirectoryIterator(path, true))
+    Suggestions result;
+
+    if (query.empty()) return result;
+
+    auto getUsage = [this](std::string const& name)
     {
-        auto file = iter.getFile();
+        auto it = objectUsage.find(name);
+        return it != objectUsage.end() ? it->second : 0;
+    };
 
-        if (file.hasFileExtension("pddoc"))
+    // Lower rank is better, ties are broken by usage and then by length
+    struct Match
+    {
+        int rank;
+        int usage;
+        std::string const* name;
+
+        bool operator<(Match const& other) const
         {
-            XmlDocument doc(file);
+            if (rank != other.rank) return rank < other.rank;
+            if (usage != other.usage) return usage > other.usage;
+            if (name->size() != other.name->size()) return name->size() < other.name->size();
+            return *name < *other.name;
+        }
+    };
 
-            auto elt = doc.getDocumentElement();
-            // elt->setTagName(file.getFileNameWithoutExtension());
+    std::vector<Match> prefixMatches;
+    std::vector<Match> otherMatches;
 
-            auto object = elt->getChildByName("object");
-            auto name = object->getStringAttribute("name");
+    // Prefix matches are a contiguous range of the sorted names
+    auto first = std::lower_bound(objectNames.begin(), objectNames.end(), query);
+    auto last = first;
+    while (last != objectNames.end() && last->compare(0, query.size(), query) == 0) last++;
 
-            auto meta = object->getChildByName("meta");
+    for (auto it = first; it != last; it++)
+    {
+        prefixMatches.push_back({*it == query ? 0 : 1, getUsage(*it), &(*it)});
+    }
 
-            auto keywords = meta->getChildElementAllSubText("keywords", "");
-            auto description = meta->getChildElementAllSubText("description", "");
+    auto isSubsequence = [&query](std::string const& name)
+    {
+        size_t position = 0;
+        for (char c : name)
+        {
+            if (position < query.size() && c == query[position]) position++;
+        }
+        return position == query.size();
+    };
+
+    auto docs = documentation->get();
+
+    auto hasKeyword = [&docs, keyword = String(query)](std::string const& name)
+    {
+        if (!docs) return false;
 
-            objectDescriptions[name] = description;
-            objectKeywords[name] = StringArray::fromTokens(keywords, false);
+        auto keywords = docs->keywords.find(String(name));
+        if (keywords == docs->keywords.end()) return false;
+
+        for (auto& word : keywords->second)
+        {
+            if (word.startsWithIgnoreCase(keyword)) return true;
+        }
+        return false;
+    };
+
+    // Only look further when there's room left for more suggestions
+    if (static_cast<int>(prefixMatches.size()) < maxSuggestions)
+    {
+        for (auto it = objectNames.begin(); it != objectNames.end(); it++)
+        {
+            if (it == first)
+            {
+                it = last;
+                if (it == objectNames.end()) break;
+            }
+
+            auto& name = *it;
+
+            if (name.find(query) != std::string::npos)
+            {
+                otherMatches.push_back({2, getUsage(name), &name});
+            }
+            else if (hasKeyword(name))
+            {
+                otherMatches.push_back({3, getUsage(name), &name});
+            }
+            else if (query.size() > 1 && isSubsequence(name))
+            {
+                otherMatches.push_back({4, getUsage(name), &name});
+            }
         }
     }
+
+    auto addBest = [&result](std::vector<Match>& matches, bool canComplete)
+    {
+        auto numToAdd = std::min<size_t>(matches.size(), maxSuggestions - result.size());
+        std::partial_sort(matches.begin(), matches.begin() + numToAdd, matches.end());
+
+        for (size_t i = 0; i < numToAdd; i++)
+        {
+            result.push_back({*matches[i].name, canComplete});
+        }
+    };
+
+    addBest(prefixMatches, true);
+    addBest(otherMatches, false);
+
+    return result;
 }
 
-Suggestions Library::autocomplete(std::string query)
+void Library::registerUsage(const String& name)
 {
-    Suggestions result;
-    searchTree.autocomplete(std::move(query), result);
-    return result;
+    objectUsage[name.toStdString()]++;
 }
 
 void Library::timerCallback()
@@ -8,6 +8,7 @@
 #include <JuceHeader.h>
 
 #include <array>
+#include <unordered_map>
 #include <vector>
 
 namespace pd
@@ -16,46 +17,43 @@ namespace pd
 using Suggestion = std::pair<std::string, bool>;
 using Suggestions = std::vector<Suggestion>;
 
-// Define the character size
-#define CHAR_SIZE 128
-#define CHAR_TO_INDEX(c) (static_cast<int>(c) - static_cast<int>('\0'))
+// Object descriptions and keywords from the pddoc files
+struct Documentation
+{
+    std::unordered_map<String, String> descriptions;
+    std::unordered_map<String, StringArray> keywords;
+};
 
-// A class to store a Trie node
-class Trie
+// Loads the documentation once per process on a background thread, shared through a SharedResourcePointer
+// The parsed result is cached in a binary index file, which is reused until one of the documentation directories changes
+class DocumentationIndex : private Thread
 {
    public:
-    bool isLeaf;
-    Trie* character[CHAR_SIZE];
+    DocumentationIndex();
+    ~DocumentationIndex() override;
 
-    // Constructor
-    Trie()
-    {
-        isLeaf = false;
+    // Starts loading, only the first call has an effect
+    void load();
 
-        for (int i = 0; i < CHAR_SIZE; i++)
-        {
-            character[i] = nullptr;
-        }
-    }
+    // Returns nullptr while the documentation is still loading
+    std::shared_ptr<const Documentation> get() const;
 
-    ~Trie()
-    {
-        for (int i = 0; i < CHAR_SIZE; i++)
-        {
-            if (character[i])
-            {
-                delete character[i];
-            }
-        }
-    }
-
-    void insert(const std::string& key);
-    bool deletion(Trie*&, std::string);
-    bool search(const std::string&);
-    bool hasChildren();
-
-    void suggestionsRec(std::string currPrefix, Suggestions& result);
-    int autocomplete(std::string query, Suggestions& result);
+   private:
+    void run() override;
+
+    uint64 getDirectoryStamp() const;
+    std::shared_ptr<Documentation> readIndex(uint64 stamp) const;
+    void writeIndex(Documentation const& result, uint64 stamp) const;
+    std::shared_ptr<Documentation> parseDocumentation() const;
+
+    static inline constexpr int indexMagic = 0x58444450;  // "PDDX"
+    static inline constexpr int indexVersion = 1;
+
+    File documentationDir;
+    File indexFile;
+
+    std::atomic<bool> started = false;
+    std::shared_ptr<const Documentation> documentation;
 };
 
 struct Library : public Timer
@@ -63,17 +61,34 @@ struct Library : public Timer
     void initialiseLibrary();
 
     void updateLibrary();
-    void parseDocumentation(const String& path);
 
+    // Returns the best matching names: prefix matches first (these can be autocompleted),
+    // then substring, keyword and fuzzy matches, each ranked by how often the name was used
     Suggestions autocomplete(std::string query);
 
+    // Counts an object that the user created, to rank it higher in suggestions
+    void registerUsage(const String& name);
+
     void timerCallback() override;
 
-    std::unordered_map<String, String> objectDescriptions;
-    std::unordered_map<String, StringArray> objectKeywords;
+    SharedResourcePointer<DocumentationIndex> documentation;
+
     std::unordered_map<String, std::pair<StringArray, StringArray>> edgeDescriptions;
 
-    Trie searchTree;
+    // All object and abstraction names, sorted for prefix lookups
+    std::vector<std::string> objectNames;
+    std::unordered_map<std::string, int> objectUsage;
+
+    // Abstractions per search path, a path is only listed again when its modification time changes
+    struct SearchPathContent
+    {
+        Time lastModified;
+        std::vector<std::string> names;
+    };
+
+    std::unordered_map<String, SearchPathContent> searchPathContents;
+
+    static inline constexpr int maxSuggestions = 20;
 
     File appDataDir;
 
@@ -0,0 +1,385 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_set>
+
+#include "PdParallel.h"
+
+extern "C"
+{
+#include <g_canvas.h>
+#include <z_libpd.h>
+
+#include "d_libpd_ugen.h"
+#include "g_libpd_clone.h"
+}
+
+namespace pd
+{
+
+// Signal classes whose perform routine only touches the object itself and the signals passed to it
+// Anything else, like dac~, delay lines, arrays, send~/receive~ or objects that set clocks, keeps its container
+// on the audio thread
+static std::unordered_set<std::string_view> const independentClasses = {
+    // d_arithmetic.c and d_math.c
+    "+~", "-~", "*~", "/~", "max~", "min~", "abs~", "wrap~", "sqrt~", "rsqrt~", "pow~", "exp~", "log~", "clip~",
+    "mtof~", "ftom~", "dbtorms~", "rmstodb~", "dbtopow~", "powtodb~",
+    // d_osc.c and d_ctl.c
+    "osc~", "cos~", "phasor~", "noise~", "vcf~", "sig~", "line~", "vline~", "snapshot~", "vsnapshot~",
+    // d_filter.c
+    "lop~", "hip~", "bp~", "biquad~", "samphold~", "rpole~", "rzero~", "rzero_rev~", "cpole~", "czero~", "czero_rev~", "slop~",
+    // g_io.c and d_dac.c, adc~ only reads the input buffers
+    "inlet~", "outlet~", "block~", "adc~"};
+
+// Set while a thread runs a single segment, so the routine that ends it stops the thread there
+static thread_local bool runningSegment = false;
+
+struct ParallelDsp::Job
+{
+    Job(t_pdinstance* pdInstance, t_int* dspChain, std::vector<int> const& segmentsToRun)
+        : instance(pdInstance)
+        , chain(dspChain)
+        , segments(segmentsToRun.data())
+        , size(static_cast<int>(segmentsToRun.size()))
+    {
+    }
+
+    // Segments are claimed by the audio thread and the workers alike
+    void run()
+    {
+        int index;
+
+        while ((index = nextSegment.fetch_add(1, std::memory_order_relaxed)) < size)
+        {
+            runningSegment = true;
+
+            auto* w = chain + segments[index];
+            while (w) w = (*reinterpret_cast<t_perfroutine>(*w))(w);
+
+            runningSegment = false;
+        }
+    }
+
+    t_pdinstance* const instance;
+    t_int* const chain;
+    int const* const segments;
+    int const size;
+
+    std::atomic<int> nextSegment = 0;
+};
+
+// One set of workers for all instances, so several instances don't start more threads than there are cores
+class ParallelDsp::WorkerPool
+{
+   public:
+    ~WorkerPool()
+    {
+        for (auto* worker : workers)
+        {
+            worker->signalThreadShouldExit();
+            worker->wake.signal();
+        }
+
+        for (auto* worker : workers)
+        {
+            worker->stopThread(1000);
+        }
+    }
+
+    void start()
+    {
+        ScopedLock lock(startLock);
+
+        if (!workers.isEmpty()) return;
+
+        // The audio thread runs segments as well
+        auto numWorkers = jmax(0, SystemStats::getNumCpus() - 1);
+
+        for (int i = 0; i < numWorkers; i++)
+        {
+            workers.add(new Worker(*this))->startThread();
+        }
+
+        numStarted.store(numWorkers, std::memory_order_release);
+    }
+
+    //! @brief Runs a job on the audio thread and the workers, returns false if another instance is using the workers.
+    bool run(Job& job)
+    {
+        bool expected = false;
+        if (!busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) return false;
+
+        auto numWorkers = std::min(numStarted.load(std::memory_order_acquire), job.size - 1);
+
+        currentJob = &job;
+        activeWorkers.store(numWorkers, std::memory_order_relaxed);
+
+        for (int i = 0; i < numWorkers; i++)
+        {
+            workers.getUnchecked(i)->wake.signal();
+        }
+
+        job.run();
+
+        // Everything after the group reads what the segments wrote. The last worker to finish signals, even if
+        // the audio thread was the one to run every segment, so we wait exactly once for every job we handed out
+        if (numWorkers > 0) finished.wait();
+
+        busy.store(false, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    class Worker : public Thread
+    {
+       public:
+        explicit Worker(WorkerPool& owner) : Thread("Pd DSP Worker"), pool(owner)
+        {
+        }
+
+        void run() override
+        {
+            while (true)
+            {
+                wake.wait();
+                if (threadShouldExit()) return;
+
+                auto* job = pool.currentJob;
+
+                {
+                    ScopedNoDenormals noDenormals;
+                    libpd_set_instance(job->instance);
+                    job->run();
+                }
+
+                if (pool.activeWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1) pool.finished.signal();
+            }
+        }
+
+        WaitableEvent wake;
+
+       private:
+        WorkerPool& pool;
+    };
+
+    CriticalSection startLock;
+    OwnedArray<Worker> workers;
+    std::atomic<int> numStarted = 0;
+
+    std::atomic<bool> busy = false;
+    Job* currentJob = nullptr;
+    std::atomic<int> activeWorkers = 0;
+    WaitableEvent finished;
+};
+
+ParallelDsp::ParallelDsp() : methods(this, &ParallelDsp::containerDsp)
+{
+}
+
+ParallelDsp::~ParallelDsp()
+{
+    // The instance has to be locked to put the methods back, so that happens before we get here
+    jassert(!isEnabled());
+}
+
+void ParallelDsp::startWorkers()
+{
+    pool->start();
+}
+
+t_int* ParallelDsp::perform(t_int* w)
+{
+    auto* parallel = reinterpret_cast<ParallelDsp*>(w[1]);
+    auto* group = reinterpret_cast<Group*>(w[2]);
+
+    // A single segment gains nothing from a worker, it runs in place like the rest of the chain
+    if (group->segments.size() < 2) return w + 3;
+
+    // Positions are counted from the start of the chain, which our own position tells us
+    auto* chain = w - group->position;
+
+    Job job(pd_this, chain, group->segments);
+
+    // While another instance uses the workers, the segments run in place
+    if (!parallel->pool->run(job)) return w + 3;
+
+    return chain + group->end;
+}
+
+t_int* ParallelDsp::finishSegment(t_int* w)
+{
+    return runningSegment ? nullptr : w + 1;
+}
+
+void ParallelDsp::containerDsp(t_object* object, t_signal** signals)
+{
+    auto* methods = DspMethods::find(&ParallelDsp::containerDsp);
+
+    // The method is only swapped in while it can be found
+    jassert(methods);
+    if (!methods) return;
+
+    auto* parallel = methods->getOwner<ParallelDsp>();
+
+    // Containers inside a top-level container run along with it
+    if (parallel->building)
+    {
+        methods->callOriginal(object, signals);
+        return;
+    }
+
+    parallel->addContainer(object, signals);
+}
+
+bool ParallelDsp::isIndependent(t_object* object)
+{
+    auto* cls = pd_class(&object->ob_pd);
+
+    if (cls == canvas_class)
+    {
+        for (t_gobj* y = reinterpret_cast<t_canvas*>(object)->gl_list; y; y = y->g_next)
+        {
+            auto* child = pd_checkobject(&y->g_pd);
+            if (child && !isIndependent(child)) return false;
+        }
+
+        return true;
+    }
+
+    if (cls == libpd_clone_getclass())
+    {
+        for (int i = 0; i < libpd_clone_getnumvoices(object); i++)
+        {
+            if (!isIndependent(&libpd_clone_getvoice(object, i)->gl_obj)) return false;
+        }
+
+        return true;
+    }
+
+    // Objects without a dsp method have nothing in the chain
+    if (!zgetfn(&object->ob_pd, gensym("dsp"))) return true;
+
+    return independentClasses.count(cls->c_name->s_name) > 0;
+}
+
+void ParallelDsp::addContainer(t_object* object, t_signal** signals)
+{
+    // A new chain is being built, the groups of the previous one went with it
+    if (ugen_getsortno() != sortNumber)
+    {
+        groups.clear();
+        sortNumber = ugen_getsortno();
+    }
+
+    auto* group = groups.empty() ? nullptr : groups.back().get();
+
+    // Its routines stay in the chain after the group and run on the audio thread
+    if (!isIndependent(object))
+    {
+        if (group) group->closed = true;
+
+        building = true;
+        methods.callOriginal(object, signals);
+        building = false;
+        return;
+    }
+
+    int numInputs = obj_nsiginlets(object);
+    int numOutputs = obj_nsigoutlets(object);
+
+    auto contains = [](std::vector<t_sample*> const& buffers, t_sample* buffer) { return std::find(buffers.begin(), buffers.end(), buffer) != buffers.end(); };
+
+    // Containers may read the same buffer at once, but not one that another container writes
+    auto overlaps = [&](Group const& other)
+    {
+        for (int i = 0; i < numInputs; i++)
+        {
+            if (contains(other.outputs, signals[i]->s_vec)) return true;
+        }
+
+        for (int i = numInputs; i < numInputs + numOutputs; i++)
+        {
+            if (contains(other.inputs, signals[i]->s_vec) || contains(other.outputs, signals[i]->s_vec)) return true;
+        }
+
+        return false;
+    };
+
+    // Perform routines are appended in front of the dsp_done entry that always ends the chain
+    // Only a container that directly follows the group can join it, routines in between have to run after the group
+    if (!group || group->closed || group->end != libpd_ugen_getchainsize() - 1 || overlaps(*group))
+    {
+        groups.push_back(std::make_unique<Group>());
+        group = groups.back().get();
+
+        group->position = libpd_ugen_getchainsize() - 1;
+        dsp_add(&ParallelDsp::perform, 2, this, group);
+        group->end = libpd_ugen_getchainsize() - 1;
+    }
+
+    int start = libpd_ugen_getchainsize() - 1;
+
+    // Signals freed while the container is built never go back to the free lists, so its buffers stay its own
+    t_libpd_ugen_heldsignals heldSignals;
+    libpd_ugen_holdsignals(&heldSignals);
+
+    building = true;
+    methods.callOriginal(object, signals);
+    building = false;
+
+    libpd_ugen_releasesignals(&heldSignals);
+
+    for (int i = 0; i < numInputs; i++)
+    {
+        group->inputs.push_back(signals[i]->s_vec);
+    }
+
+    for (int i = numInputs; i < numInputs + numOutputs; i++)
+    {
+        group->outputs.push_back(signals[i]->s_vec);
+    }
+
+    if (libpd_ugen_getchainsize() - 1 > start)
+    {
+        group->segments.push_back(start);
+        dsp_add(&ParallelDsp::finishSegment, 0);
+    }
+
+    group->end = libpd_ugen_getchainsize() - 1;
+}
+
+void ParallelDsp::setEnabled(bool shouldBeEnabled)
+{
+    if (isEnabled() == shouldBeEnabled) return;
+
+    if (shouldBeEnabled)
+    {
+        // Every slot is taken by other instances
+        if (!methods.attach()) return;
+
+        methods.wrap(canvas_class);
+        methods.wrap(libpd_clone_getclass());
+    }
+    else
+    {
+        methods.detach();
+    }
+
+    enabled = shouldBeEnabled;
+
+    // Rebuild, so every top-level container reports where its routines are, or to run them in place again
+    canvas_update_dsp();
+
+    if (!shouldBeEnabled)
+    {
+        groups.clear();
+        sortNumber = -1;
+    }
+}
+
+}  // namespace pd
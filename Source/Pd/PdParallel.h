@@ -0,0 +1,95 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "PdDspMethods.h"
+
+extern "C"
+{
+#include <m_pd.h>
+}
+
+namespace pd
+{
+//! @brief Runs independent top-level subpatches and clones of an instance on worker threads.
+//! @details While enabled, the "dsp" method of subpatches and clone is swapped for one that records where the
+//! routines of each top-level container end up in the dsp chain. Containers that follow each other directly
+//! in the chain form a group, headed by a routine that hands the containers to the workers and joins them
+//! before the rest of the chain runs, so everything after the group, like dac~, sees all of their output.
+//! The routines stay where pd put them, which keeps the jumps of block~ and switch~ intact.\n
+//! Only containers made of signal objects that keep to their own state, like osc~ or lop~, run on a worker.
+//! A container with any other signal object runs on the audio thread after the group. A container joins the
+//! previous group only if its signal buffers don't overlap with those of the group. While a container is built,
+//! the signals it frees are kept out of pd's free lists, so no other container gets to reuse its buffers.\n
+//! The workers are shared by every instance in the process. A group that finds them busy with another instance
+//! runs on the audio thread.
+class ParallelDsp
+{
+   public:
+    ParallelDsp();
+    ~ParallelDsp();
+
+    //! @brief Starts the shared worker threads, called from the message thread before the mode is first enabled.
+    void startWorkers();
+
+    //! @brief Turns the parallel mode on or off and rebuilds the chain, called with the instance locked.
+    void setEnabled(bool shouldBeEnabled);
+
+    bool isEnabled() const noexcept
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+   private:
+    class WorkerPool;
+    struct Job;
+
+    struct Group
+    {
+        // Chain position of the routine that runs the group, and after the last routine of the group
+        int position = 0;
+        int end = 0;
+
+        // Chain position of the first routine of every container in the group
+        std::vector<int> segments;
+
+        // Signal buffers the containers in the group read and write
+        std::vector<t_sample*> inputs;
+        std::vector<t_sample*> outputs;
+
+        // Set once a container that can't run on a worker was added after the group
+        bool closed = false;
+    };
+
+    static t_int* perform(t_int* w);
+    static t_int* finishSegment(t_int* w);
+    static void containerDsp(t_object* object, t_signal** signals);
+
+    static bool isIndependent(t_object* object);
+
+    void addContainer(t_object* object, t_signal** signals);
+
+    std::atomic<bool> enabled = false;
+
+    DspMethods methods;
+
+    // Groups of the chain pd is building or running, recorded while it was built
+    std::vector<std::unique_ptr<Group>> groups;
+    int sortNumber = -1;
+
+    // Set while a top-level container is being built
+    bool building = false;
+
+    SharedResourcePointer<WorkerPool> pool;
+};
+}  // namespace pd
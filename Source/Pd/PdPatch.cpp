@@ -6,6 +6,8 @@
 
 #include "PdPatch.h"
 
+#include <atomic>
+
 #include "PdGui.h"
 #include "PdInstance.h"
 #include "PdObject.h"
@@ -70,8 +72,15 @@ Patch::Patch(void* patchPtr, Instance* parentInstance) noexcept : ptr(patchPtr),
 
         instance->getCallbackLock()->exit();
 
-        infoObject = getInfoObject();
-        updateExtraInfo();
+        // Only parse the plugdatainfo comment the first time we see this canvas
+        auto& store = instance->getExtraInfoStore(cnv);
+        if (!store)
+        {
+            store = extraInfo;
+            infoObject = getInfoObject();
+            updateExtraInfo();
+        }
+        extraInfo = store;
         
         canvas_undo_add(cnv, UNDO_SEQUENCE_START, "MainSeq", 0);
     }
@@ -122,6 +131,18 @@ void Patch::setCurrent(bool lock)
     if (lock) instance->getCallbackLock()->exit();
 }
 
+// Checks the first atom of comments directly, building an Object and its text for every element is too slow for index lookups
+static bool isInfoObject(t_gobj* y)
+{
+    if (pd_class(&y->g_pd) != text_class) return false;
+
+    auto* text = reinterpret_cast<t_text*>(y);
+    if (text->te_type != T_TEXT || !text->te_binbuf || binbuf_getnatom(text->te_binbuf) < 1) return false;
+
+    auto* atom = binbuf_getvec(text->te_binbuf);
+    return atom->a_type == A_SYMBOL && atom->a_w.w_symbol == gensym("plugdatainfo");
+}
+
 int Patch::getIndex(void* obj)
 {
     int i = 0;
@@ -129,9 +150,7 @@ int Patch::getIndex(void* obj)
 
     for (t_gobj* y = cnv->gl_list; y; y = y->g_next)
     {
-        Object object(static_cast<void*>(y), this, instance);
-
-        if (String(object.getText()).startsWith("plugdatainfo")) continue;
+        if (isInfoObject(y)) continue;
 
         if (obj == y)
         {
@@ -171,9 +190,9 @@ std::vector<Object> Patch::getObjects(bool onlyGui) noexcept
 
         for (t_gobj* y = cnv->gl_list; y; y = y->g_next)
         {
-            Object object(static_cast<void*>(y), this, instance);
+            if (isInfoObject(y)) continue;
 
-            if (String(object.getText()).startsWith("plugdatainfo")) continue;
+            Object object(static_cast<void*>(y), this, instance);
 
             if (onlyGui)
             {
@@ -196,19 +215,21 @@ std::vector<Object> Patch::getObjects(bool onlyGui) noexcept
 std::unique_ptr<Object> Patch::createGraphOnParent(int x, int y)
 {
     t_pd* pdobject = nullptr;
+    std::atomic<bool> done = false;
     instance->enqueueFunction(
-        [this, x, y, &pdobject]() mutable
+        [this, x, y, &pdobject, &done]() mutable
         {
             setCurrent();
             pdobject = libpd_creategraphonparent(getPointer(), x, y);
+            done = true;
         });
 
-    while (!pdobject)
+    while (!done)
     {
         instance->waitForStateUpdate();
     }
 
-    assert(pdobject);
+    if (!pdobject) return nullptr;
 
     return std::make_unique<Gui>(pdobject, this, instance);
 }
@@ -216,19 +237,21 @@ std::unique_ptr<Object> Patch::createGraphOnParent(int x, int y)
 std::unique_ptr<Object> Patch::createGraph(const String& name, int size, int x, int y)
 {
     t_pd* pdobject = nullptr;
+    std::atomic<bool> done = false;
     instance->enqueueFunction(
-        [this, name, size, x, y, &pdobject]() mutable
+        [this, name, size, x, y, &pdobject, &done]() mutable
         {
             setCurrent();
             pdobject = libpd_creategraph(getPointer(), name.toRawUTF8(), size, x, y);
+            done = true;
         });
 
-    while (!pdobject)
+    while (!done)
     {
         instance->waitForStateUpdate();
     }
 
-    assert(pdobject);
+    if (!pdobject) return nullptr;
 
     return std::make_unique<Gui>(pdobject, this, instance);
 }
@@ -237,6 +260,43 @@ std::unique_ptr<Object> Patch::createObject(const String& name, int x, int y, bo
 {
     if (!ptr) return nullptr;
 
+    t_pd* pdobject = nullptr;
+    std::atomic<bool> done = false;
+    instance->enqueueFunction(
+        [this, name, x, y, undoable, &pdobject, &done]() mutable
+        {
+            setCurrent();
+            pdobject = instantiateObject(name, x, y, undoable);
+            done = true;
+        });
+
+    // Waiting for the job rather than the object, pd returns null when it can't create the object
+    while (!done)
+    {
+        instance->waitForStateUpdate();
+    }
+
+    if (!pdobject) return nullptr;
+
+    return wrapObject(pdobject);
+}
+
+std::unique_ptr<Object> Patch::wrapObject(t_pd* pdobject)
+{
+    bool isGui = Gui::getType(pdobject) != Type::Undefined;
+
+    if (isGui)
+    {
+        return std::make_unique<Gui>(pdobject, this, instance);
+    }
+    else
+    {
+        return std::make_unique<Object>(pdobject, this, instance);
+    }
+}
+
+t_pd* Patch::instantiateObject(const String& name, int x, int y, bool undoable)
+{
     StringArray tokens;
     tokens.addTokens(name, false);
 
@@ -247,11 +307,11 @@ std::unique_ptr<Object> Patch::createObject(const String& name, int x, int y, bo
 
     if (tokens[0] == "graph" && tokens.size() == 3)
     {
-        return createGraph(tokens[1], tokens[2].getIntValue(), x, y);
+        return libpd_creategraph(getPointer(), tokens[1].toRawUTF8(), tokens[2].getIntValue(), x, y);
     }
     else if (tokens[0] == "graph")
     {
-        return createGraphOnParent(x, y);
+        return libpd_creategraphonparent(getPointer(), x, y);
     }
 
     t_symbol* typesymbol = gensym("obj");
@@ -292,7 +352,6 @@ std::unique_ptr<Object> Patch::createObject(const String& name, int x, int y, bo
 
     for (int i = 0; i < tokens.size(); i++)
     {
-        auto& tok = tokens[i];
         if (tokens[i].containsOnly("0123456789e.-+") && tokens[i] != "-")
         {
             SETFLOAT(argv.data() + i + 2, tokens[i].getFloatValue());
@@ -303,31 +362,184 @@ std::unique_ptr<Object> Patch::createObject(const String& name, int x, int y, bo
         }
     }
 
-    t_pd* pdobject = nullptr;
-    instance->enqueueFunction(
-        [this, argc, argv, undoable, typesymbol, &pdobject]() mutable
+    return libpd_createobj(getPointer(), typesymbol, argc, argv.data(), undoable);
+}
+
+int Patch::Transaction::createObject(const String& name, int x, int y, bool undoable)
+{
+    int index = numObjects++;
+
+    edits.push_back([name, x, y, undoable, index](Patch& patch, std::vector<t_pd*>& created) { created[index] = patch.instantiateObject(name, x, y, undoable); });
+
+    return index;
+}
+
+void Patch::Transaction::createConnection(int src, int nout, int sink, int nin)
+{
+    jassert(src >= 0 && src < numObjects && sink >= 0 && sink < numObjects);
+
+    edits.push_back(
+        [src, nout, sink, nin](Patch& patch, std::vector<t_pd*>& created)
         {
-            setCurrent();
-            pdobject = libpd_createobj(getPointer(), typesymbol, argc, argv.data(), undoable);
+            auto* srcObject = created[src] ? pd_checkobject(created[src]) : nullptr;
+            auto* sinkObject = created[sink] ? pd_checkobject(created[sink]) : nullptr;
+
+            if (srcObject && sinkObject && libpd_canconnect(patch.getPointer(), srcObject, nout, sinkObject, nin))
+            {
+                libpd_createconnection(patch.getPointer(), srcObject, nout, sinkObject, nin);
+            }
+        });
+}
+
+void Patch::Transaction::createConnection(Object* src, int nout, Object* sink, int nin)
+{
+    auto* srcObject = src ? checkObject(src) : nullptr;
+    auto* sinkObject = sink ? checkObject(sink) : nullptr;
+
+    edits.push_back(
+        [srcObject, nout, sinkObject, nin](Patch& patch, std::vector<t_pd*>&)
+        {
+            if (srcObject && sinkObject && libpd_canconnect(patch.getPointer(), srcObject, nout, sinkObject, nin))
+            {
+                libpd_createconnection(patch.getPointer(), srcObject, nout, sinkObject, nin);
+            }
         });
+}
 
-    while (!pdobject)
+void Patch::Transaction::moveObjects(const std::vector<Object*>& objects, int dx, int dy)
+{
+    std::vector<t_object*> toMove;
+    for (auto* obj : objects)
     {
-        instance->waitForStateUpdate();
+        if (auto* object = obj ? checkObject(obj) : nullptr) toMove.push_back(object);
     }
 
-    assert(pdobject);
+    edits.push_back(
+        [toMove, dx, dy](Patch& patch, std::vector<t_pd*>&)
+        {
+            glist_noselect(patch.getPointer());
+
+            for (auto* object : toMove)
+            {
+                glist_select(patch.getPointer(), &object->te_g);
+            }
 
-    bool isGui = Gui::getType(pdobject) != Type::Undefined;
+            libpd_moveselection(patch.getPointer(), dx, dy);
 
-    if (isGui)
+            glist_noselect(patch.getPointer());
+            EDITOR->canvas_undo_already_set_move = 0;
+        });
+}
+
+void Patch::Transaction::removeObjects(const std::vector<Object*>& objects)
+{
+    std::vector<t_object*> toRemove;
+    for (auto* obj : objects)
     {
-        return std::make_unique<Gui>(pdobject, this, instance);
+        if (auto* object = obj ? checkObject(obj) : nullptr) toRemove.push_back(object);
     }
-    else
+
+    edits.push_back(
+        [toRemove](Patch& patch, std::vector<t_pd*>&)
+        {
+            glist_noselect(patch.getPointer());
+
+            for (auto* object : toRemove)
+            {
+                glist_select(patch.getPointer(), &object->te_g);
+            }
+
+            // Starts the undo sequence that finishRemove ends
+            libpd_removeselection(patch.getPointer());
+        });
+}
+
+void Patch::Transaction::removeConnection(Object* src, int nout, Object* sink, int nin)
+{
+    auto* srcObject = src ? checkObject(src) : nullptr;
+    auto* sinkObject = sink ? checkObject(sink) : nullptr;
+
+    edits.push_back(
+        [srcObject, nout, sinkObject, nin](Patch& patch, std::vector<t_pd*>&)
+        {
+            if (srcObject && sinkObject) libpd_removeconnection(patch.getPointer(), srcObject, nout, sinkObject, nin);
+        });
+}
+
+void Patch::Transaction::finishRemove()
+{
+    edits.push_back([](Patch& patch, std::vector<t_pd*>&) { libpd_finishremove(patch.getPointer()); });
+}
+
+// Pasted and duplicated objects are the selection pd leaves behind
+static void appendSelection(t_canvas* cnv, std::vector<t_pd*>& created)
+{
+    for (t_gobj* y = cnv->gl_list; y; y = y->g_next)
     {
-        return std::make_unique<Object>(pdobject, this, instance);
+        if (glist_isselected(cnv, y)) created.push_back(&y->g_pd);
+    }
+
+    glist_noselect(cnv);
+}
+
+void Patch::Transaction::paste(const String& text)
+{
+    edits.push_back(
+        [text](Patch& patch, std::vector<t_pd*>& created)
+        {
+            glist_noselect(patch.getPointer());
+            libpd_paste(patch.getPointer(), text.toRawUTF8());
+            appendSelection(patch.getPointer(), created);
+        });
+}
+
+void Patch::Transaction::duplicate(const std::vector<Object*>& objects)
+{
+    std::vector<t_object*> toDuplicate;
+    for (auto* obj : objects)
+    {
+        if (auto* object = obj ? checkObject(obj) : nullptr) toDuplicate.push_back(object);
     }
+
+    edits.push_back(
+        [toDuplicate](Patch& patch, std::vector<t_pd*>& created)
+        {
+            glist_noselect(patch.getPointer());
+
+            for (auto* object : toDuplicate)
+            {
+                glist_select(patch.getPointer(), &object->te_g);
+            }
+
+            libpd_duplicate(patch.getPointer());
+            appendSelection(patch.getPointer(), created);
+        });
+}
+
+void Patch::performTransaction(Transaction transaction, std::function<void(std::vector<t_pd*> const&)> onComplete)
+{
+    if (!ptr) return;
+
+    // The job holds its own copy of the patch, so the transaction can outlive the caller's Patch
+    instance->enqueueFunction(
+        [patch = *this, transaction = std::move(transaction), onComplete]() mutable
+        {
+            patch.setCurrent();
+
+            std::vector<t_pd*> created(transaction.numObjects, nullptr);
+
+            for (auto& edit : transaction.edits)
+            {
+                edit(patch, created);
+            }
+
+            patch.setCurrent();
+
+            if (onComplete)
+            {
+                MessageManager::callAsync([created = std::move(created), onComplete]() { onComplete(created); });
+            }
+        });
 }
 
 static int glist_getindex(t_glist* x, t_gobj* y)
@@ -353,8 +565,12 @@ std::unique_ptr<Object> Patch::renameObject(Object* obj, const String& name)
     {
         auto b = obj->getBounds();
 
+        t_pd* pdobject = nullptr;
+        std::atomic<bool> done = false;
+
+        // One job, so pd never runs with the object removed but not yet recreated
         instance->enqueueFunction(
-            [this, obj]()
+            [this, obj, name, b, &pdobject, &done]()
             {
                 setCurrent();
                 glist_noselect(getPointer());
@@ -362,13 +578,21 @@ std::unique_ptr<Object> Patch::renameObject(Object* obj, const String& name)
                 canvas_stowconnections(getPointer());
                 libpd_removeselection(getPointer());
                 glist_noselect(getPointer());
+
+                pdobject = instantiateObject(name, b.getX(), b.getY(), true);
+
+                canvas_restoreconnections(getPointer());
+                done = true;
             });
 
-        auto obj = createObject(name, b.getX(), b.getY());
+        while (!done)
+        {
+            instance->waitForStateUpdate();
+        }
 
-        instance->enqueueFunction([this]() { canvas_restoreconnections(getPointer()); });
+        if (!pdobject) return nullptr;
 
-        return obj;
+        return wrapObject(pdobject);
     }
 
     instance->enqueueFunction([this, obj, name]() mutable { libpd_renameobj(getPointer(), &checkObject(obj)->te_g, name.toRawUTF8(), name.length()); });
@@ -398,25 +622,6 @@ void Patch::copy()
     });
 }
 
-void Patch::paste()
-{
-    auto text = SystemClipboard::getTextFromClipboard();
-    
-    instance->enqueueFunction([this, text]() mutable {
-        libpd_paste(getPointer(), text.toRawUTF8());
-    });
-}
-
-void Patch::duplicate()
-{
-    instance->enqueueFunction(
-        [this]()
-        {
-            setCurrent();
-            libpd_duplicate(getPointer());
-        });
-}
-
 void Patch::selectObject(Object* obj)
 {
     instance->enqueueFunction(
@@ -499,53 +704,6 @@ void Patch::removeConnection(Object* src, int nout, Object* sink, int nin)
         });
 }
 
-void Patch::moveObjects(const std::vector<Object*>& objects, int dx, int dy)
-{
-    // if(!obj || !ptr) return;
-
-    instance->enqueueFunction(
-        [this, objects, dx, dy]() mutable
-        {
-            setCurrent();
-
-            glist_noselect(getPointer());
-
-            for (auto* obj : objects)
-            {
-                if (!obj) continue;
-
-                glist_select(getPointer(), &checkObject(obj)->te_g);
-            }
-
-            libpd_moveselection(getPointer(), dx, dy);
-
-            glist_noselect(getPointer());
-            EDITOR->canvas_undo_already_set_move = 0;
-            setCurrent();
-        });
-}
-
-void Patch::finishRemove()
-{
-    instance->enqueueFunction(
-        [this]() mutable
-        {
-            setCurrent();
-            libpd_finishremove(getPointer());
-        });
-}
-
-void Patch::removeSelection()
-{
-    instance->enqueueFunction(
-        [this]() mutable
-        {
-            setCurrent();
-
-            libpd_removeselection(getPointer());
-        });
-}
-
 void Patch::undo()
 {
     instance->enqueueFunction(
@@ -615,7 +773,8 @@ void Patch::updateExtraInfo()
     auto tree = ValueTree::fromXml(istream.readString());
     if (tree.isValid())
     {
-        extraInfo = tree;
+        extraInfo->tree = tree;
+        extraInfo->dirty = false;
         return;
     }
 }
@@ -653,19 +812,18 @@ t_gobj* Patch::getInfoObject()
 }
 void Patch::setExtraInfoId(const String& oldId, const String& newId)
 {
-    auto child = extraInfo.getChildWithProperty("ID", oldId);
+    auto child = extraInfo->tree.getChildWithProperty("ID", oldId);
 
     if (child.isValid())
     {
         child.setProperty("ID", newId, nullptr);
+        extraInfo->dirty = true;
     }
-
-    storeExtraInfo();
 }
 
 void Patch::storeExtraInfo()
 {
-    String infoString = Base64::toBase64(extraInfo.toXmlString());
+    String infoString = Base64::toBase64(extraInfo->tree.toXmlString());
 
     t_gobj* info = getInfoObject();
 
@@ -674,18 +832,20 @@ void Patch::storeExtraInfo()
     // This is likely thread safe because nothing else should access this object
     binbuf_text((reinterpret_cast<t_text*>(info))->te_binbuf, newname.toRawUTF8(), newname.length());
 
+    extraInfo->dirty = false;
+
     deselectAll();
 }
 
 bool Patch::hasExtraInfo(const String& id) const
 {
-    auto child = extraInfo.getChildWithProperty("ID", id);
+    auto child = extraInfo->tree.getChildWithProperty("ID", id);
     return child.isValid();
 }
 
 MemoryBlock Patch::getExtraInfo(const String& id) const
 {
-    auto child = extraInfo.getChildWithProperty("ID", id);
+    auto child = extraInfo->tree.getChildWithProperty("ID", id);
 
     MemoryBlock block;
 
@@ -700,7 +860,7 @@ void Patch::setExtraInfo(const String& id, MemoryBlock& info)
 {
     auto tree = ValueTree("Connection");
 
-    auto existingInfo = extraInfo.getChildWithProperty("ID", id);
+    auto existingInfo = extraInfo->tree.getChildWithProperty("ID", id);
     if (existingInfo.isValid())
     {
         tree = existingInfo;
@@ -711,10 +871,11 @@ void Patch::setExtraInfo(const String& id, MemoryBlock& info)
 
     if (!existingInfo.isValid())
     {
-        extraInfo.appendChild(tree, nullptr);
+        extraInfo->tree.appendChild(tree, nullptr);
     }
 
-    storeExtraInfo();
+    // Serialised to the plugdatainfo comment by Instance::storeExtraInfo
+    extraInfo->dirty = true;
 }
 
 String Patch::getTitle() const
@@ -8,6 +8,7 @@
 #include <JuceHeader.h>
 
 #include <array>
+#include <memory>
 #include <vector>
 
 #include "PdGui.h"
@@ -19,6 +20,15 @@ namespace pd
 using Connections = std::vector<std::tuple<int, t_object*, int, t_object*>>;
 class Instance;
 
+//! @brief Editor state plugdata keeps for a canvas, like connection paths and the background colour.
+//! @details Shared by every Patch of the same canvas, and only written to the plugdatainfo comment\n
+//! when the patch gets saved or its state is captured.
+struct ExtraInfo
+{
+    ValueTree tree = ValueTree("PlugDataInfo");
+    bool dirty = false;
+};
+
 //! @brief The Pd patch.
 //! @details The class is a wrapper around a Pd patch. The lifetime of the internal patch\n
 //! is not guaranteed by the class.
@@ -46,13 +56,41 @@ class Patch
     std::unique_ptr<Object> createGraphOnParent(int x, int y);
 
     std::unique_ptr<Object> createObject(const String& name, int x, int y, bool undoable = true);
-    void removeObject(Object* obj);
-    std::unique_ptr<Object> renameObject(Object* obj, const String& name);
 
-    void moveObjects(const std::vector<Object*>&, int x, int y);
+    //! @brief A batch of edits that runs in one job on pd's thread.
+    //! @details Objects created in the transaction are referred to by the index that createObject returns.\n
+    //! Objects that paste and duplicate create are appended to the created objects after those.
+    class Transaction
+    {
+       public:
+        int createObject(const String& name, int x, int y, bool undoable = true);
+
+        void createConnection(int src, int nout, int sink, int nin);
+        void createConnection(Object* src, int nout, Object* sink, int nin);
+
+        void moveObjects(const std::vector<Object*>& objects, int dx, int dy);
+
+        //! @brief Removes the objects, call finishRemove after removing any other connections to group them in one undo action.
+        void removeObjects(const std::vector<Object*>& objects);
+        void removeConnection(Object* src, int nout, Object* sink, int nin);
+        void finishRemove();
 
-    void finishRemove();
-    void removeSelection();
+        void paste(const String& text);
+        void duplicate(const std::vector<Object*>& objects);
+
+       private:
+        std::vector<std::function<void(Patch&, std::vector<t_pd*>&)>> edits;
+        int numObjects = 0;
+
+        friend class Patch;
+    };
+
+    //! @brief Performs all edits of a transaction in one locked pass, in the order they were added.
+    //! @details Unlike the single edit functions, this doesn't wait for pd. onComplete is called on the message\n
+    //! thread with the created objects, or null where creation failed, which is the time to synchronise the canvas once.
+    void performTransaction(Transaction transaction, std::function<void(std::vector<t_pd*> const&)> onComplete = nullptr);
+    void removeObject(Object* obj);
+    std::unique_ptr<Object> renameObject(Object* obj, const String& name);
 
     void selectObject(Object*);
     void deselectAll();
@@ -60,8 +98,6 @@ class Patch
     void setZoom(int zoom);
 
     void copy();
-    void paste();
-    void duplicate();
 
     void undo();
     void redo();
@@ -107,7 +143,7 @@ class Patch
     MemoryBlock getExtraInfo(const String& id) const;
     void setExtraInfo(const String& id, MemoryBlock& info);
 
-    ValueTree extraInfo = ValueTree("PlugDataInfo");
+    std::shared_ptr<ExtraInfo> extraInfo = std::make_shared<ExtraInfo>();
 
     static t_object* checkObject(Object* obj) noexcept;
 
@@ -119,6 +155,12 @@ class Patch
     std::vector<t_template*> getTemplates() const;
 
    private:
+    // Creates an object from its text, must be called on pd's thread
+    t_pd* instantiateObject(const String& name, int x, int y, bool undoable);
+
+    // Wraps a pd object as a Gui if it is one
+    std::unique_ptr<Object> wrapObject(t_pd* pdobject);
+
     void* ptr = nullptr;
     Instance* instance = nullptr;
 
@@ -0,0 +1,222 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "PdProfiler.h"
+
+#if JUCE_INTEL
+#if JUCE_MSVC
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+extern "C"
+{
+#include <g_canvas.h>
+}
+
+namespace pd
+{
+
+Profiler::Profiler() : methods(this, &Profiler::dsp)
+{
+}
+
+Profiler::~Profiler()
+{
+    // The instance has to be locked to put the methods back, so that happens before we get here
+    jassert(!isEnabled());
+}
+
+uint64 Profiler::getTimestamp() noexcept
+{
+#if JUCE_INTEL
+    return __rdtsc();
+#else
+    return static_cast<uint64>(Time::getHighResolutionTicks());
+#endif
+}
+
+t_int* Profiler::start(t_int* w)
+{
+    auto* profiler = reinterpret_cast<Profiler*>(w[1]);
+    profiler->startTimestamp = getTimestamp();
+
+    return w + 2;
+}
+
+t_int* Profiler::stop(t_int* w)
+{
+    auto* profiler = reinterpret_cast<Profiler*>(w[1]);
+    auto& ticks = profiler->stats[w[2]].ticks;
+
+    ticks.store(ticks.load(std::memory_order_relaxed) + (getTimestamp() - profiler->startTimestamp), std::memory_order_relaxed);
+
+    return w + 3;
+}
+
+void Profiler::dsp(t_object* object, t_signal** signals)
+{
+    auto* methods = DspMethods::find(&Profiler::dsp);
+
+    // The method is only swapped in while it can be found
+    jassert(methods);
+    if (!methods) return;
+
+    methods->getOwner<Profiler>()->addTimers(object, signals);
+}
+
+void Profiler::addTimers(t_object* object, t_signal** signals)
+{
+    // A new chain is being built, so the table starts over
+    if (ugen_getsortno() != sortNumber)
+    {
+        sortNumber = ugen_getsortno();
+        count = 0;
+
+        numStats.store(0, std::memory_order_release);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    // Objects inside a timed object run within its timers, and objects past the end of the table aren't timed
+    if (depth > 0 || count >= maxObjects)
+    {
+        depth++;
+        methods.callOriginal(object, signals);
+        depth--;
+        return;
+    }
+
+    auto stat = count++;
+
+    stats[stat].object.store(object, std::memory_order_relaxed);
+    stats[stat].name.store(pd_class(&object->ob_pd)->c_name->s_name, std::memory_order_relaxed);
+    stats[stat].ticks.store(0, std::memory_order_relaxed);
+
+    numStats.store(count, std::memory_order_release);
+
+    dsp_add(&Profiler::start, 1, this);
+
+    depth++;
+    methods.callOriginal(object, signals);
+    depth--;
+
+    dsp_add(&Profiler::stop, 2, this, static_cast<t_int>(stat));
+}
+
+void Profiler::setEnabled(bool shouldBeEnabled)
+{
+    if (isEnabled() == shouldBeEnabled) return;
+
+    if (shouldBeEnabled)
+    {
+        // Every slot is taken by other instances
+        if (!methods.attach()) return;
+
+        wrapDspMethods();
+    }
+    else
+    {
+        methods.detach();
+    }
+
+    enabled = shouldBeEnabled;
+
+    // Rebuild, so the chain gets or loses its timers
+    canvas_update_dsp();
+
+    checkedSortNumber = ugen_getsortno();
+
+    if (!shouldBeEnabled)
+    {
+        sortNumber = -1;
+
+        numStats.store(0, std::memory_order_release);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+}
+
+bool Profiler::wrapDspMethods(t_canvas* cnv)
+{
+    bool wrappedNewClass = false;
+
+    for (t_gobj* y = cnv->gl_list; y; y = y->g_next)
+    {
+        auto* cls = pd_class(&y->g_pd);
+
+        // Subpatches only pass the dsp call on to their contents, so we time those instead
+        if (cls == canvas_class)
+        {
+            wrappedNewClass |= wrapDspMethods(reinterpret_cast<t_canvas*>(y));
+            continue;
+        }
+
+        wrappedNewClass |= methods.wrap(cls);
+    }
+
+    return wrappedNewClass;
+}
+
+bool Profiler::wrapDspMethods()
+{
+    bool wrappedNewClass = false;
+
+    for (t_canvas* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next)
+    {
+        wrappedNewClass |= wrapDspMethods(cnv);
+    }
+
+    return wrappedNewClass;
+}
+
+void Profiler::update()
+{
+    if (!isEnabled() || ugen_getsortno() == checkedSortNumber) return;
+
+    // Objects of classes we haven't seen were added since the last rebuild, time those too
+    if (wrapDspMethods())
+    {
+        canvas_update_dsp();
+    }
+
+    checkedSortNumber = ugen_getsortno();
+}
+
+std::vector<Profiler::Load> Profiler::getLoads()
+{
+    std::vector<Load> loads;
+
+    auto now = getTimestamp();
+    auto elapsed = now - readTimestamp;
+    readTimestamp = now;
+
+    // The table was refilled, so the ticks started counting from zero again
+    auto currentGeneration = generation.load(std::memory_order_acquire);
+    if (currentGeneration != readGeneration)
+    {
+        readTicks.fill(0);
+        readGeneration = currentGeneration;
+    }
+
+    int count = numStats.load(std::memory_order_acquire);
+    if (elapsed == 0 || count == 0) return loads;
+
+    loads.reserve(static_cast<size_t>(count));
+
+    for (int i = 0; i < count; i++)
+    {
+        auto ticks = stats[i].ticks.load(std::memory_order_relaxed);
+        auto delta = ticks >= readTicks[i] ? ticks - readTicks[i] : ticks;
+        readTicks[i] = ticks;
+
+        loads.push_back({stats[i].object.load(std::memory_order_relaxed), stats[i].name.load(std::memory_order_relaxed), static_cast<float>(static_cast<double>(delta) / static_cast<double>(elapsed))});
+    }
+
+    return loads;
+}
+
+}  // namespace pd
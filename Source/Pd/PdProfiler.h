@@ -0,0 +1,102 @@
+/*
+ // Copyright (c) 2021-2022 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "PdDspMethods.h"
+
+extern "C"
+{
+#include <m_pd.h>
+}
+
+namespace pd
+{
+//! @brief Measures how much of the dsp time every object in an instance takes.
+//! @details While enabled, the "dsp" method of every signal class is swapped for one that puts a timer routine
+//! before and after the routines of each object as the chain is built. The timers read the cycle counter and add
+//! the difference to a preallocated slot for the object. They are added while the chain is built, so the jumps
+//! of block~ and switch~ cover them like any other routine. Objects inside a timed object, like the voices of
+//! clone, are timed along with it.\n
+//! When disabled, the original methods are put back and the chain is rebuilt without timers.
+class Profiler
+{
+   public:
+    struct Load
+    {
+        void* object;
+        const char* name;
+        float load;  // fraction of the realtime that passed since the previous measurement
+    };
+
+    static constexpr int maxObjects = 4096;
+
+    Profiler();
+    ~Profiler();
+
+    //! @brief Turns profiling on or off and rebuilds the chain, called with the instance locked.
+    void setEnabled(bool shouldBeEnabled);
+
+    bool isEnabled() const noexcept
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Times classes that were added since the last call, called with the instance locked.
+    //! @details This walks the whole patch and may rebuild the chain, but only if the chain changed since the last call.
+    void update();
+
+    //! @brief Returns the load of every timed object since the previous call, called from the message thread.
+    std::vector<Load> getLoads();
+
+   private:
+    struct Stat
+    {
+        std::atomic<void*> object = nullptr;
+        std::atomic<const char*> name = nullptr;
+        std::atomic<uint64> ticks = 0;
+    };
+
+    static uint64 getTimestamp() noexcept;
+    static t_int* start(t_int* w);
+    static t_int* stop(t_int* w);
+    static void dsp(t_object* object, t_signal** signals);
+
+    bool wrapDspMethods(t_canvas* cnv);
+    bool wrapDspMethods();
+
+    void addTimers(t_object* object, t_signal** signals);
+
+    std::atomic<bool> enabled = false;
+
+    DspMethods methods;
+
+    // Only touched while the chain is built
+    int sortNumber = -1;
+    int checkedSortNumber = -1;
+    int depth = 0;
+    int count = 0;
+
+    // Only touched while the chain runs
+    uint64 startTimestamp = 0;
+
+    // Written while the chain is built and run, read by the message thread
+    std::array<Stat, maxObjects> stats;
+    std::atomic<int> numStats = 0;
+    std::atomic<uint32> generation = 0;
+
+    // Only touched by the message thread
+    std::array<uint64, maxObjects> readTicks = {};
+    uint32 readGeneration = 0;
+    uint64 readTimestamp = 0;
+};
+}  // namespace pd
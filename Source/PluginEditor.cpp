@@ -207,6 +207,30 @@ PlugDataPluginEditor::PlugDataPluginEditor(PlugDataAudioProcessor& p) : AudioPro
 
     addAndMakeVisible(toolbarButton(Hide));
 
+    sidebar.onProfileUpdate = [this](std::vector<pd::Profiler::Load> const& loads)
+    {
+        for (auto* cnv : canvases) cnv->showProfile(loads);
+    };
+
+    // Selects the object in the current canvas when it's picked from the profiler
+    sidebar.onProfileSelect = [this](void* object)
+    {
+        auto* cnv = getCurrentCanvas();
+        if (!cnv) return;
+
+        for (auto* box : cnv->boxes)
+        {
+            if (box->pdObject && box->pdObject->getPointer() == object)
+            {
+                cnv->deselectAll();
+                cnv->setSelected(box, true);
+                break;
+            }
+        }
+    };
+
+    sidebar.showProfiler(pd.isProfilingEnabled());
+
     // window size limits
     constrainer.setSizeLimits(700, 300, 4000, 4000);
     addAndMakeVisible(resizer);
@@ -445,20 +469,63 @@ void PlugDataPluginEditor::saveProject(const std::function<void()>& nestedCallba
     }
 }
 
-void PlugDataPluginEditor::updateValues()
+void PlugDataPluginEditor::updateValues(std::unordered_set<void*> const& targets)
 {
     auto* cnv = getCurrentCanvas();
 
     if (!cnv) return;
 
+    bool updateAll = targets.empty() || targets.count(cnv->patch.getPointer());
+
+    struct PolledValue
+    {
+        Component::SafePointer<GUIComponent> component;
+        pd::Gui gui;
+        float value = 0.0f;
+    };
+
+    // Values are read in one job on pd's thread, and applied in one call on the message thread
+    auto batch = std::make_shared<std::vector<PolledValue>>();
+    batch->reserve(cnv->boxes.size());
+
     for (auto& box : cnv->boxes)
     {
         if (box->graphics && box->isShowing())
         {
-            box->graphics->updateValue();
+            if (box->graphics->pollsValue())
+            {
+                if (!updateAll && (!box->pdObject || !targets.count(box->pdObject->getPointer()))) continue;
+
+                batch->push_back({box->graphics.get(), box->graphics->getGui()});
+            }
+            else
+            {
+                box->graphics->updateValue();
+            }
         }
     }
 
+    if (!batch->empty())
+    {
+        pd.enqueueFunction(
+            [batch]()
+            {
+                for (auto& polled : *batch)
+                {
+                    polled.value = polled.gui.getValue();
+                }
+
+                MessageManager::callAsync(
+                    [batch]()
+                    {
+                        for (auto& polled : *batch)
+                        {
+                            if (polled.component) polled.component->receiveValue(polled.value);
+                        }
+                    });
+            });
+    }
+
     updateCommandStatus();
 }
 
@@ -914,15 +981,7 @@ bool PlugDataPluginEditor::perform(const InvocationInfo& info)
         case CommandIDs::ConnectionPathfind:
         {
             auto* cnv = getCurrentCanvas();
-
-            for (auto* con : cnv->connections)
-            {
-                if (cnv->isSelected(con))
-                {
-                    con->findPath();
-                    con->updatePath();
-                }
-            }
+            Connection::findPaths(cnv, cnv->getSelectionOfType<Connection>());
 
             return true;
         }
@@ -8,6 +8,8 @@
 
 #include <JuceHeader.h>
 
+#include <unordered_set>
+
 #include "Dialogs.h"
 #include "Sidebar.h"
 #include "Statusbar.h"
@@ -87,7 +89,9 @@ class PlugDataPluginEditor : public AudioProcessorEditor, public Value::Listener
     Canvas* getCurrentCanvas();
     Canvas* getCanvas(int idx);
 
-    void updateValues();
+    // Refreshes the values of the gui objects on the current canvas
+    // When targets are given, only objects in it or on a canvas in it are refreshed
+    void updateValues(std::unordered_set<void*> const& targets = {});
 
     void valueChanged(Value& v) override;
 
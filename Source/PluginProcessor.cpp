@@ -10,6 +10,11 @@
 #include "PluginEditor.h"
 #include "LookAndFeel.h"
 
+extern "C"
+{
+#include "x_libpd_multi.h"
+}
+
 AudioProcessor::BusesProperties PlugDataAudioProcessor::buildBusesProperties()
 {
     AudioProcessor::BusesProperties busesProperties;
@@ -40,22 +45,40 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
     for (int n = 0; n < numParameters; n++)
     {
         String id = "param" + String(n + 1);
-        parameters.createAndAddParameter(std::make_unique<AudioParameterFloat>(id, "Parameter " + String(n + 1), 0.0f, 1.0f, 0.0f));
+        auto* parameter = parameters.createAndAddParameter(std::make_unique<AudioParameterFloat>(id, "Parameter " + String(n + 1), 0.0f, 1.0f, 0.0f));
+        parameter->addListener(this);
         parameterValues[n] = parameters.getRawParameterValue(id);
+        parameterSymbols[n] = generateSymbol(id);
         lastParameters[n] = 0;
     }
 
+    firstParameterIndex = parameters.getParameter("param1")->getParameterIndex();
+    for (auto& dirty : parameterDirty)
+    {
+        dirty.store(0);
+    }
+
     volume = parameters.getRawParameterValue("volume");
     enabled = parameters.getRawParameterValue("enabled");
 
     parameters.replaceState(ValueTree("PlugData"));
 
+    auto startupTime = Time::getMillisecondCounterHiRes();
+
     // On first startup, initialise abstractions and settings
     initialiseFilesystem();
 
+    auto filesystemTime = Time::getMillisecondCounterHiRes();
 
     // Initialise library for text autocompletion
     objectLibrary.initialiseLibrary();
+
+    auto libraryTime = Time::getMillisecondCounterHiRes();
+
+    double libpdInitTime, classSetupTime;
+    libpd_multi_get_init_times(&libpdInitTime, &classSetupTime);
+
+    Logger::writeToLog(String::formatted("PlugData startup: libpd %.1f ms, class setup %.1f ms, filesystem %.1f ms, library scan %.1f ms", libpdInitTime * 1000.0, classSetupTime * 1000.0, filesystemTime - startupTime, libraryTime - filesystemTime));
     
     // Update pd search paths for abstractions
     updateSearchPaths();
@@ -80,10 +103,14 @@ PlugDataAudioProcessor::PlugDataAudioProcessor()
     };
 
     logMessage("PlugData v" + String(ProjectInfo::versionString));
+
+    startTimer(15);
 }
 
 PlugDataAudioProcessor::~PlugDataAudioProcessor()
 {
+    stopTimer();
+
     // Save current settings before quitting
     saveSettings();
 }
@@ -309,18 +336,7 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
         buffer.clear(i, 0, buffer.getNumSamples());
     }
 
-    for (int n = 0; n < numParameters; n++)
-    {
-        if (parameterValues[n]->load() != lastParameters[n])
-        {
-            lastParameters[n] = parameterValues[n]->load();
-
-            parameterAtom[0] = {pd::Atom(lastParameters[n])};
-
-            String toSend = ("param" + String(n + 1));
-            sendList(toSend.toRawUTF8(), parameterAtom);
-        }
-    }
+    sendParameters();
 
     midiBufferCopy.clear();
     midiBufferCopy.addEvents(midiMessages, 0, buffer.getNumSamples(), audioAdvancement);
@@ -332,6 +348,36 @@ void PlugDataAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer
     statusbarSource.processBlock(buffer, midiBufferCopy, midiMessages);
 }
 
+void PlugDataAudioProcessor::parameterValueChanged(int parameterIndex, float newValue)
+{
+    const int n = parameterIndex - firstParameterIndex;
+    if (n >= 0 && n < numParameters)
+    {
+        parameterDirty[n / 64].fetch_or(uint64(1) << (n % 64));
+    }
+}
+
+void PlugDataAudioProcessor::sendParameters()
+{
+    // Sent before the block is processed, so each new value arrives at its first tick
+    for (int word = 0; word < numParameters / 64; word++)
+    {
+        auto dirty = parameterDirty[word].exchange(0);
+        for (int bit = 0; dirty != 0; bit++, dirty >>= 1)
+        {
+            if (!(dirty & 1)) continue;
+
+            const int n = word * 64 + bit;
+            const float value = parameterValues[n]->load();
+            if (value != lastParameters[n])
+            {
+                sendList(parameterSymbols[n], value);
+                lastParameters[n] = value;
+            }
+        }
+    }
+}
+
 void PlugDataAudioProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
     ScopedNoDenormals noDenormals;
@@ -352,6 +398,15 @@ void PlugDataAudioProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midi
         buffer.clear(i, 0, numSamples);
     }
 
+    // If the block is a whole number of ticks and nothing is left over from
+    // the previous block, pd can read and write the host buffers directly
+    // Both paths output one tick late, so we can switch between them at any block
+    if (audioAdvancement == 0 && numSamples > 0 && numSamples % blockSize == 0)
+    {
+        processDirect(buffer, midiMessages);
+        return;
+    }
+
     // If the current number of samples in this block
     // is inferior to the number of samples required
     if (numSamples < numLeft)
@@ -431,7 +486,7 @@ void PlugDataAudioProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midi
             }
             if (midiConsume)
             {
-                midiBufferIn.addEvents(midiin, pos, blockSize, 0);
+                midiBufferIn.addEvents(midiin, pos, blockSize, -pos);
             }
             if (midiProduce)
             {
@@ -459,7 +514,7 @@ void PlugDataAudioProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midi
             }
             if (midiConsume)
             {
-                midiBufferIn.addEvents(midiin, pos, remaining, 0);
+                midiBufferIn.addEvents(midiin, pos, remaining, -pos);
             }
             if (midiProduce)
             {
@@ -470,6 +525,103 @@ void PlugDataAudioProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midi
     }
 }
 
+void PlugDataAudioProcessor::processDirect(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    const int blockSize = Instance::getBlockSize();
+    const int numSamples = buffer.getNumSamples();
+    const int numTicks = numSamples / blockSize;
+    const int numIn = getTotalNumInputChannels();
+    const int numOut = getTotalNumOutputChannels();
+    const int numChannels = buffer.getNumChannels();
+    const bool midiConsume = acceptsMidi();
+    const bool midiProduce = producesMidi();
+    const bool isEnabled = static_cast<bool>(enabled->load());
+
+    const float** bufferIn = buffer.getArrayOfReadPointers();
+    float** bufferOut = buffer.getArrayOfWritePointers();
+
+    std::array<const float*, 32> inputs;
+    std::array<float*, 32> outputs;
+
+    if (!isEnabled)
+    {
+        for (int j = 0; j < numIn; ++j)
+        {
+            buffer.clear(j, 0, numSamples);
+        }
+    }
+
+    // Midi from the tick that is still pending goes out at the start of this block
+    if (midiProduce)
+    {
+        midiBufferTemp.clear();
+        midiBufferTemp.swapWith(midiBufferOut);
+        resetMidiOut();
+    }
+
+    // Dequeue messages
+    sendMessagesFromQueue();
+
+    // Midi is timestamped in pd's logical time, so all ticks can run under a single lock
+    setMidiTimeReference(numSamples);
+    if (midiConsume)
+    {
+        midiBufferIn.addEvents(midiMessages, 0, numSamples, 0);
+        sendMidiBuffer();
+    }
+
+    for (int j = 0; j < std::min(numChannels, 32); ++j)
+    {
+        inputs[j] = bufferIn[j];
+        outputs[j] = bufferOut[j];
+    }
+
+    performDSP(inputs.data(), outputs.data(), numTicks);
+
+    // Receive messages and midi that pd sent during these ticks
+    sendMessagesFromQueue();
+
+    const int lastTick = numSamples - blockSize;
+
+    if (!isEnabled)
+    {
+        buffer.clear();
+        std::fill(audioBufferOut.begin(), audioBufferOut.end(), 0.f);
+    }
+    else
+    {
+        // Delay the output by one tick, like the FIFO does: the pending tick goes in front,
+        // and the last tick we just computed becomes the pending one
+        for (int j = 0; j < std::min(numOut, 32); ++j)
+        {
+            auto* pending = audioBufferOut.data() + j * blockSize;
+            std::swap_ranges(pending, pending + blockSize, bufferOut[j] + lastTick);
+            std::rotate(bufferOut[j], bufferOut[j] + lastTick, bufferOut[j] + numSamples);
+        }
+    }
+
+    if (midiProduce)
+    {
+        midiMessages.clear();
+        midiMessages.addEvents(midiBufferTemp, 0, blockSize, 0);
+        midiMessages.addEvents(midiBufferOut, 0, lastTick, blockSize);
+
+        // Keep the midi of the last tick for the next block, relative to the start of that tick
+        midiBufferTemp.clear();
+        midiBufferTemp.addEvents(midiBufferOut, lastTick, blockSize, -lastTick);
+        midiBufferOut.swapWith(midiBufferTemp);
+    }
+}
+
+void PlugDataAudioProcessor::resetMidiOut()
+{
+    midiByteIndex = 0;
+    midiByteBuffer[0] = 0;
+    midiByteBuffer[1] = 0;
+    midiByteBuffer[2] = 0;
+    midiBufferOut.clear();
+}
+
 void PlugDataAudioProcessor::messageEnqueued()
 {
     if (isNonRealtime() || isSuspended())
@@ -494,52 +646,21 @@ void PlugDataAudioProcessor::sendMidiBuffer()
         for (const auto& event : midiBufferIn)
         {
             auto const message = event.getMessage();
-            if (message.isNoteOn())
-            {
-                sendNoteOn(message.getChannel(), message.getNoteNumber(), message.getVelocity());
-            }
-            else if (message.isNoteOff())
-            {
-                sendNoteOn(message.getChannel(), message.getNoteNumber(), 0);
-            }
-            else if (message.isController())
-            {
-                sendControlChange(message.getChannel(), message.getControllerNumber(), message.getControllerValue());
-            }
-            else if (message.isPitchWheel())
-            {
-                sendPitchBend(message.getChannel(), message.getPitchWheelValue() - 8192);
-            }
-            else if (message.isChannelPressure())
-            {
-                sendAfterTouch(message.getChannel(), message.getChannelPressureValue());
-            }
-            else if (message.isAftertouch())
-            {
-                sendPolyAfterTouch(message.getChannel(), message.getNoteNumber(), message.getAfterTouchValue());
-            }
-            else if (message.isProgramChange())
-            {
-                sendProgramChange(message.getChannel(), message.getProgramChangeNumber());
-            }
-            else if (message.isSysEx())
+            if (message.isSysEx())
             {
                 for (int i = 0; i < message.getSysExDataSize(); ++i)
                 {
                     sendSysEx(0, static_cast<int>(message.getSysExData()[i]));
                 }
-            }
-            else if (message.isMidiClock() || message.isMidiStart() || message.isMidiStop() || message.isMidiContinue() || message.isActiveSense() || (message.getRawDataSize() == 1 && message.getRawData()[0] == 0xff))
-            {
-                for (int i = 0; i < message.getRawDataSize(); ++i)
+                for (int i = 0; i < message.getRawDataSize(); i++)
                 {
-                    sendSysRealTime(0, static_cast<int>(message.getRawData()[i]));
+                    sendMidiByte(0, static_cast<int>(message.getRawData()[i]));
                 }
             }
-
-            for (int i = 0; i < message.getRawDataSize(); i++)
+            // Short messages are delivered by pd's scheduler at their position in the block
+            else
             {
-                sendMidiByte(0, static_cast<int>(message.getRawData()[i]));
+                scheduleMidiMessage(event.samplePosition, message.getRawData(), message.getRawDataSize());
             }
         }
         midiBufferIn.clear();
@@ -550,9 +671,16 @@ void PlugDataAudioProcessor::processInternal()
 {
     // setThis();
 
+    // Midi out is collected per tick, after the previous tick has been copied to the host
+    if (producesMidi())
+    {
+        resetMidiOut();
+    }
+
     // Dequeue messages
     sendMessagesFromQueue();
 
+    setMidiTimeReference(Instance::getBlockSize());
     sendMidiBuffer();
 
     // Process audio
@@ -572,16 +700,8 @@ void PlugDataAudioProcessor::processInternal()
         std::fill(audioBufferOut.begin(), audioBufferOut.end(), 0.f);
     }
 
-    // Midi out
-
-    if (producesMidi())
-    {
-        midiByteIndex = 0;
-        midiByteBuffer[0] = 0;
-        midiByteBuffer[1] = 0;
-        midiByteBuffer[2] = 0;
-        midiBufferOut.clear();
-    }
+    // Receive messages and midi that pd sent during this tick
+    sendMessagesFromQueue();
 }
 
 bool PlugDataAudioProcessor::hasEditor() const
@@ -636,6 +756,8 @@ void PlugDataAudioProcessor::getStateInformation(MemoryBlock& destData)
     // Store pure-data state
     MemoryOutputStream ostream(destData, false);
 
+    storeExtraInfo();
+
     ostream.writeString(getPatch().getCanvasContent());
     ostream.writeInt(getLatencySamples());
     ostream.writeInt(static_cast<int>(xmlBlock.getSize()));
@@ -740,37 +862,37 @@ void PlugDataAudioProcessor::receiveNoteOn(const int channel, const int pitch, c
 {
     if (velocity == 0)
     {
-        midiBufferOut.addEvent(MidiMessage::noteOff(channel, pitch, uint8(0)), audioAdvancement);
+        midiBufferOut.addEvent(MidiMessage::noteOff(channel, pitch, uint8(0)), getMidiOffset());
     }
     else
     {
-        midiBufferOut.addEvent(MidiMessage::noteOn(channel, pitch, static_cast<uint8>(velocity)), audioAdvancement);
+        midiBufferOut.addEvent(MidiMessage::noteOn(channel, pitch, static_cast<uint8>(velocity)), getMidiOffset());
     }
 }
 
 void PlugDataAudioProcessor::receiveControlChange(const int channel, const int controller, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::controllerEvent(channel, controller, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::controllerEvent(channel, controller, value), getMidiOffset());
 }
 
 void PlugDataAudioProcessor::receiveProgramChange(const int channel, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::programChange(channel, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::programChange(channel, value), getMidiOffset());
 }
 
 void PlugDataAudioProcessor::receivePitchBend(const int channel, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::pitchWheel(channel, value + 8192), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::pitchWheel(channel, value + 8192), getMidiOffset());
 }
 
 void PlugDataAudioProcessor::receiveAftertouch(const int channel, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::channelPressureChange(channel, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::channelPressureChange(channel, value), getMidiOffset());
 }
 
 void PlugDataAudioProcessor::receivePolyAftertouch(const int channel, const int pitch, const int value)
 {
-    midiBufferOut.addEvent(MidiMessage::aftertouchChange(channel, pitch, value), audioAdvancement);
+    midiBufferOut.addEvent(MidiMessage::aftertouchChange(channel, pitch, value), getMidiOffset());
 }
 
 void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
@@ -779,7 +901,7 @@ void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
     {
         if (byte == 0xf7)
         {
-            midiBufferOut.addEvent(MidiMessage::createSysExMessage(midiByteBuffer, static_cast<int>(midiByteIndex)), audioAdvancement);
+            midiBufferOut.addEvent(MidiMessage::createSysExMessage(midiByteBuffer, static_cast<int>(midiByteIndex)), getMidiOffset());
             midiByteIndex = 0;
             midiByteIsSysex = false;
         }
@@ -801,52 +923,42 @@ void PlugDataAudioProcessor::receiveMidiByte(const int port, const int byte)
         midiByteBuffer[midiByteIndex++] = static_cast<uint8>(byte);
         if (midiByteIndex >= 3)
         {
-            midiBufferOut.addEvent(MidiMessage(midiByteBuffer, 3), audioAdvancement);
+            midiBufferOut.addEvent(MidiMessage(midiByteBuffer, 3), getMidiOffset());
             midiByteIndex = 0;
         }
     }
 }
 
 void PlugDataAudioProcessor::timerCallback()
+{
+    processPrints();
+    processGuiUpdates();
+}
+
+void PlugDataAudioProcessor::receiveGuiUpdates(std::vector<void*> const& targets, bool refreshAll, bool scalarsChanged)
 {
     if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor()))
     {
-        if (!callbackType) return;
-
-        if (callbackType == 1)
+        if (refreshAll)
         {
             editor->updateValues();
         }
-        else if (callbackType == 3)
+        else if (!targets.empty())
         {
-            editor->updateValues();
+            editor->updateValues(std::unordered_set<void*>(targets.begin(), targets.end()));
         }
-        else
+
+        auto* cnv = editor->getCurrentCanvas();
+        if (scalarsChanged && cnv)
         {
-            for (auto* tmpl : editor->getCurrentCanvas()->templates)
+            for (auto* tmpl : cnv->templates)
             {
                 static_cast<DrawableTemplate*>(tmpl)->update();
             }
         }
-
-        callbackType = 0;
     }
 }
 
-void PlugDataAudioProcessor::receiveGuiUpdate(int type)
-{
-    if (callbackType != 0 && callbackType != type)
-    {
-        callbackType = 3;
-    }
-    else
-    {
-        callbackType = type;
-    }
-
-    startTimer(15);
-}
-
 void PlugDataAudioProcessor::updateConsole()
 {
     if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(getActiveEditor()))
@@ -16,7 +16,7 @@
 class PlugDataDarkLook;
 
 class PlugDataPluginEditor;
-class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, public Timer, public PatchLoader
+class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, public Timer, public PatchLoader, public AudioProcessorParameter::Listener
 {
    public:
     PlugDataAudioProcessor();
@@ -44,9 +44,6 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     bool isMidiEffect() const override;
     double getTailLengthSeconds() const override;
 
-    std::atomic<int> callbackType = 0;
-    void timerCallback() override;
-
     int getNumPrograms() override;
     int getCurrentProgram() override;
     void setCurrentProgram(int index) override;
@@ -64,7 +61,13 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     void receivePolyAftertouch(const int channel, const int pitch, const int value) override;
     void receiveMidiByte(const int port, const int byte) override;
 
-    void receiveGuiUpdate(int type) override;
+    // Drains the prints and gui changes pd's thread queued on the instance
+    void timerCallback() override;
+
+    void receiveGuiUpdates(std::vector<void*> const& targets, bool refreshAll, bool scalarsChanged) override;
+
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override{};
 
     void updateConsole() override;
     
@@ -141,8 +144,6 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
 
     std::atomic<float>* volume;
 
-    std::vector<pd::Atom> parameterAtom = std::vector<pd::Atom>(1);
-
     ValueTree settingsTree = ValueTree("PlugDataSettings");
 
     pd::Library objectLibrary;
@@ -163,6 +164,9 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
 
    private:
     void processInternal();
+    void processDirect(AudioSampleBuffer&, MidiBuffer&);
+    void resetMidiOut();
+    void sendParameters();
 
     std::atomic<float>* enabled;
 
@@ -186,6 +190,11 @@ class PlugDataAudioProcessor : public AudioProcessor, public pd::Instance, publi
     std::array<std::atomic<float>*, numParameters> parameterValues = {nullptr};
     std::array<float, numParameters> lastParameters = {0};
 
+    // Receivers for "param1" etc. are interned once, changed parameters are flagged by the listener
+    std::array<t_symbol*, numParameters> parameterSymbols = {nullptr};
+    std::array<std::atomic<uint64>, numParameters / 64> parameterDirty;
+    int firstParameterIndex = 0;
+
     int minIn = 2;
     int minOut = 2;
 
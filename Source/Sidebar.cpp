@@ -473,6 +473,8 @@ struct Console : public Component
 
         void update()
         {
+            updateLayout();
+
             repaint();
             setSize(viewport.getWidth(), std::max<int>(getTotalHeight(), viewport.getHeight()));
 
@@ -487,7 +489,9 @@ struct Console : public Component
             pd->consoleHistory.insert(pd->consoleHistory.end(), pd->consoleMessages.begin(), pd->consoleMessages.end());
 
             pd->consoleMessages.clear();
+            pd->trimConsole();
 
+            invalidateLayout();
             update();
         }
 
@@ -495,10 +499,13 @@ struct Console : public Component
         {
             pd->consoleMessages.insert(pd->consoleMessages.begin(), pd->consoleHistory.begin(), pd->consoleHistory.end());
             pd->consoleHistory.clear();
+            pd->trimConsole();
+
+            invalidateLayout();
             update();
         }
 
-        int getNumLines(const String& text)
+        int getNumLines(const String& text, int width)
         {
             auto font = Font(Font::getDefaultSansSerifFontName(), 13, 0);
 
@@ -510,7 +517,7 @@ struct Console : public Component
 
             for (int i = 0; i < xOffsets.size(); i++)
             {
-                if ((xOffsets[i] + 12) >= static_cast<float>(getWidth()))
+                if ((xOffsets[i] + 12) >= static_cast<float>(width))
                 {
                     for (int j = i + 1; j < xOffsets.size(); j++)
                     {
@@ -525,53 +532,47 @@ struct Console : public Component
 
         void mouseDown(const MouseEvent& e) override
         {
-            int totalHeight = 0;
-
-            for (int row = 0; row < static_cast<int>(pd->consoleMessages.size()); row++)
-            {
-                auto& message = pd->consoleMessages[row];
+            updateLayout();
 
-                int numLines = getNumLines(message.first);
-                int height = numLines * 22 + 2;
-
-                const Rectangle<int> r(0, totalHeight, getWidth(), height);
-
-                if (r.contains(e.getPosition() + viewport.getViewPosition()))
-                {
-                    selectedItem = row;
-                    repaint();
-                    break;
-                }
+            auto row = getRowAt(e.getPosition().y);
 
-                totalHeight += height;
+            if (row >= 0)
+            {
+                selectedItem = row;
+                repaint();
             }
         }
 
         void paint(Graphics& g) override
         {
+            updateLayout();
+
             auto font = Font(Font::getDefaultSansSerifFontName(), 13, 0);
             g.setFont(font);
             g.fillAll(findColour(ComboBox::backgroundColourId));
 
-            int totalHeight = 0;
-            bool showMessages = buttons[2].getToggleState();
-            bool showErrors = buttons[3].getToggleState();
+            auto clip = g.getClipBounds();
 
-            bool rowColour = false;
+            // Only paint the rows that are visible
+            int first = getRowAt(std::max(clip.getY(), 0));
+            if (first < 0) first = static_cast<int>(rows.size());
 
-            for (int row = 0; row < static_cast<int>(pd->consoleMessages.size()); row++)
+            for (int row = first; row < static_cast<int>(rows.size()); row++)
             {
                 auto& message = pd->consoleMessages[row];
+                auto& layout = rows[row];
 
-                int numLines = getNumLines(message.first);
-                int height = numLines * 22 + 2;
+                int y = getRowY(row);
+                if (y >= clip.getBottom()) break;
 
-                const Rectangle<int> r(2, totalHeight, getWidth(), height);
+                if (layout.numLines == 0) continue;
 
-                if ((message.second == 1 && !showMessages) || (message.second == 0 && !showErrors))
-                {
-                    continue;
-                }
+                int height = layout.numLines * 22 + 2;
+
+                const Rectangle<int> r(2, y, getWidth(), height);
+
+                // Alternate colours between the rows that are shown
+                bool rowColour = (layout.shownBefore % 2) == 1;
 
                 if (rowColour || row == selectedItem)
                 {
@@ -580,14 +581,13 @@ struct Console : public Component
                     g.fillRect(r);
                 }
 
-                rowColour = !rowColour;
-
                 g.setColour(selectedItem == row ? Colours::white : colourWithType(message.second));
-                g.drawFittedText(message.first, r.reduced(4, 0), Justification::centredLeft, numLines, 1.0f);
-
-                totalHeight += height;
+                g.drawFittedText(message.first, r.reduced(4, 0), Justification::centredLeft, layout.numLines, 1.0f);
             }
 
+            int totalHeight = getTotalHeight();
+            bool rowColour = rows.empty() ? false : ((rows.back().shownBefore + (rows.back().numLines > 0)) % 2) == 1;
+
             while (totalHeight < viewport.getHeight())
             {
                 if (rowColour)
@@ -603,38 +603,104 @@ struct Console : public Component
 
         // Get total height of messages, also taking multi-line messages into account
         int getTotalHeight()
+        {
+            return rows.empty() ? 0 : static_cast<int>(rows.back().bottom - layoutOffset);
+        }
+
+        void resized() override
+        {
+            update();
+        }
+
+        int selectedItem = -1;
+
+       private:
+        // Cached layout of a console message, the number of wrapped lines only changes when the width changes
+        struct RowLayout
+        {
+            int numLines;       // 0 when the message is filtered out
+            int64 bottom;       // Running sum of row heights, including this row
+            int64 shownBefore;  // Number of shown rows before this one
+        };
+
+        void invalidateLayout()
+        {
+            rows.clear();
+            layoutOffset = 0;
+            layoutTrimmed = pd->consoleMessagesTrimmed;
+        }
+
+        // Brings the cached layout in sync with the console messages, only measuring new messages
+        void updateLayout()
         {
             bool showMessages = buttons[2].getToggleState();
             bool showErrors = buttons[3].getToggleState();
+            int width = viewport.getWidth();
 
-            auto font = Font(Font::getDefaultSansSerifFontName(), 13, 0);
-            int totalHeight = 0;
+            if (width != layoutWidth || showMessages != layoutShowMessages || showErrors != layoutShowErrors)
+            {
+                layoutWidth = width;
+                layoutShowMessages = showMessages;
+                layoutShowErrors = showErrors;
+                invalidateLayout();
+            }
 
-            int numEmpty = 0;
+            // Drop rows for messages that were trimmed from the front of the log
+            auto trimmed = std::min<uint64>(pd->consoleMessagesTrimmed - layoutTrimmed, rows.size());
+            layoutTrimmed = pd->consoleMessagesTrimmed;
 
-            for (auto& message : pd->consoleMessages)
+            for (uint64 i = 0; i < trimmed; i++)
             {
-                int numLines = getNumLines(message.first);
-                int height = numLines * 22 + 2;
-
-                if ((message.second == 1 && !showMessages) || (message.second == 0 && !showErrors)) continue;
+                layoutOffset = rows.front().bottom;
+                rows.pop_front();
+            }
 
-                totalHeight += height;
+            if (trimmed > 0 && selectedItem >= 0)
+            {
+                selectedItem = selectedItem >= static_cast<int>(trimmed) ? selectedItem - static_cast<int>(trimmed) : -1;
             }
 
-            totalHeight -= numEmpty * 24;
+            if (rows.size() > pd->consoleMessages.size()) invalidateLayout();
+
+            // The last message may have changed when repeated prints get collapsed, so it is always measured again
+            if (!rows.empty()) rows.pop_back();
+
+            for (size_t row = rows.size(); row < pd->consoleMessages.size(); row++)
+            {
+                auto& message = pd->consoleMessages[row];
+
+                bool shown = !((message.second == 1 && !showMessages) || (message.second == 0 && !showErrors));
+                int numLines = shown ? getNumLines(message.first, width) : 0;
 
-            return totalHeight;
+                int64 top = rows.empty() ? layoutOffset : rows.back().bottom;
+                int64 shownBefore = rows.empty() ? 0 : rows.back().shownBefore + (rows.back().numLines > 0);
+
+                rows.push_back({numLines, top + (numLines ? numLines * 22 + 2 : 0), shownBefore});
+            }
         }
 
-        void resized() override
+        int getRowY(int row) const
         {
-            update();
+            return static_cast<int>((row == 0 ? layoutOffset : rows[row - 1].bottom) - layoutOffset);
         }
 
-        int selectedItem = -1;
+        // Binary search for the shown row at a height, returns -1 if there is none
+        int getRowAt(int y) const
+        {
+            auto target = layoutOffset + y;
+            auto it = std::upper_bound(rows.begin(), rows.end(), target, [](int64 value, RowLayout const& row) { return value < row.bottom; });
+
+            if (y < 0 || it == rows.end()) return -1;
+            return static_cast<int>(it - rows.begin());
+        }
+
+        std::deque<RowLayout> rows;
+        int64 layoutOffset = 0;
+        uint64 layoutTrimmed = 0;
+        int layoutWidth = -1;
+        bool layoutShowMessages = true;
+        bool layoutShowErrors = true;
 
-       private:
         static Colour colourWithType(int type)
         {
             if (type == 0)
@@ -656,14 +722,154 @@ struct Console : public Component
     std::array<TextButton, 5> buttons = {TextButton(Icons::Clear), TextButton(Icons::Restore), TextButton(Icons::Error), TextButton(Icons::Message), TextButton(Icons::AutoScroll)};
 };
 
+// MARK: Profiler
+
+struct ProfilerPanel : public Component, public TableListBoxModel, private Timer
+{
+    enum ColumnIds
+    {
+        NameColumn = 1,
+        LoadColumn
+    };
+
+    explicit ProfilerPanel(pd::Instance* instance) : pd(instance)
+    {
+        table.setModel(this);
+        table.setRowHeight(24);
+        table.setColour(ListBox::backgroundColourId, Colours::transparentBlack);
+
+        auto& header = table.getHeader();
+        header.addColumn("Object", NameColumn, 140, 60, -1, TableHeaderComponent::defaultFlags);
+        header.addColumn("CPU", LoadColumn, 70, 50, 120, TableHeaderComponent::defaultFlags);
+        header.setStretchToFitActive(true);
+        header.setSortColumnId(LoadColumn, false);
+
+        addAndMakeVisible(table);
+    }
+
+    void setActive(bool active)
+    {
+        if (active)
+        {
+            // Starts the first measurement
+            pd->getProfile();
+            startTimer(250);
+        }
+        else
+        {
+            stopTimer();
+            loads.clear();
+            table.updateContent();
+
+            if (onUpdate) onUpdate(loads);
+        }
+    }
+
+    void timerCallback() override
+    {
+        loads = pd->getProfile();
+        sortLoads();
+
+        table.updateContent();
+        table.repaint();
+
+        if (onUpdate) onUpdate(loads);
+    }
+
+    void sortLoads()
+    {
+        auto byName = [](pd::Profiler::Load const& a, pd::Profiler::Load const& b) { return std::strcmp(a.name, b.name) < 0; };
+        auto byLoad = [](pd::Profiler::Load const& a, pd::Profiler::Load const& b) { return a.load < b.load; };
+
+        if (sortColumn == NameColumn)
+        {
+            std::stable_sort(loads.begin(), loads.end(), [&](auto const& a, auto const& b) { return sortForwards ? byName(a, b) : byName(b, a); });
+        }
+        else
+        {
+            std::stable_sort(loads.begin(), loads.end(), [&](auto const& a, auto const& b) { return sortForwards ? byLoad(a, b) : byLoad(b, a); });
+        }
+    }
+
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override
+    {
+        sortColumn = newSortColumnId;
+        sortForwards = isForwards;
+
+        sortLoads();
+        table.updateContent();
+        table.repaint();
+    }
+
+    int getNumRows() override
+    {
+        return static_cast<int>(loads.size());
+    }
+
+    void paintRowBackground(Graphics& g, int rowNumber, int width, int height, bool rowIsSelected) override
+    {
+        if (rowIsSelected || rowNumber % 2)
+        {
+            g.fillAll(rowIsSelected ? findColour(Slider::thumbColourId) : findColour(ResizableWindow::backgroundColourId));
+        }
+    }
+
+    void paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override
+    {
+        if (!isPositiveAndBelow(rowNumber, loads.size())) return;
+
+        auto& load = loads[rowNumber];
+
+        g.setColour(Colours::white);
+        g.setFont(Font(Font::getDefaultSansSerifFontName(), 13, 0));
+
+        auto text = columnId == NameColumn ? String(load.name) : String(load.load * 100.0f, 1) + "%";
+        g.drawText(text, 4, 0, width - 8, height, columnId == NameColumn ? Justification::centredLeft : Justification::centredRight, true);
+    }
+
+    void cellClicked(int rowNumber, int columnId, const MouseEvent& e) override
+    {
+        if (isPositiveAndBelow(rowNumber, loads.size()) && onSelect) onSelect(loads[rowNumber].object);
+    }
+
+    void resized() override
+    {
+        table.setBounds(getLocalBounds());
+    }
+
+    std::function<void(std::vector<pd::Profiler::Load> const&)> onUpdate;
+    std::function<void(void*)> onSelect;
+
+   private:
+    pd::Instance* pd;
+    std::vector<pd::Profiler::Load> loads;
+
+    int sortColumn = LoadColumn;
+    bool sortForwards = false;
+
+    TableListBox table;
+};
+
 Sidebar::Sidebar(pd::Instance* instance)
 {
     // Can't use RAII because unique pointer won't compile with forward declarations
     console = new Console(instance);
     inspector = new Inspector;
+    profiler = new ProfilerPanel(instance);
 
     addAndMakeVisible(console);
     addAndMakeVisible(inspector);
+    addChildComponent(profiler);
+
+    profiler->onUpdate = [this](std::vector<pd::Profiler::Load> const& loads)
+    {
+        if (onProfileUpdate) onProfileUpdate(loads);
+    };
+
+    profiler->onSelect = [this](void* object)
+    {
+        if (onProfileSelect) onProfileSelect(object);
+    };
 
     setBounds(getParentWidth() - lastWidth, 40, lastWidth, getParentHeight() - 40);
 }
@@ -672,6 +878,7 @@ Sidebar::~Sidebar()
 {
     delete console;
     delete inspector;
+    delete profiler;
 }
 
 void Sidebar::paint(Graphics& g)
@@ -699,6 +906,7 @@ void Sidebar::resized()
 
     console->setBounds(bounds);
     inspector->setBounds(bounds);
+    profiler->setBounds(bounds);
 }
 
 void Sidebar::mouseDown(const MouseEvent& e)
@@ -792,6 +1000,7 @@ void Sidebar::showParameters(ObjectParameters& params)
     {
         inspector->setVisible(true);
         console->setVisible(false);
+        profiler->setVisible(false);
     }
 }
 
@@ -803,6 +1012,7 @@ void Sidebar::showParameters()
     {
         inspector->setVisible(true);
         console->setVisible(false);
+        profiler->setVisible(false);
     }
 }
 void Sidebar::hideParameters()
@@ -810,7 +1020,8 @@ void Sidebar::hideParameters()
     if (!pinned)
     {
         inspector->setVisible(false);
-        console->setVisible(true);
+        console->setVisible(!profiling);
+        profiler->setVisible(profiling);
     }
 
     if (pinned)
@@ -824,7 +1035,20 @@ void Sidebar::hideParameters()
 
 bool Sidebar::isShowingConsole() const noexcept
 {
-    return console->isVisible();
+    return console->isVisible() || profiler->isVisible();
+}
+
+void Sidebar::showProfiler(bool show)
+{
+    profiling = show;
+    profiler->setActive(show);
+
+    // Takes the place of the console, unless the inspector is open
+    if (!inspector->isVisible())
+    {
+        console->setVisible(!profiling);
+        profiler->setVisible(profiling);
+    }
 }
 
 void Sidebar::updateConsole()
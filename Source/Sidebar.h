@@ -7,8 +7,11 @@
 #pragma once
 #include <JuceHeader.h>
 
+#include "Pd/PdProfiler.h"
+
 struct Console;
 struct Inspector;
+struct ProfilerPanel;
 
 namespace pd
 {
@@ -66,11 +69,19 @@ struct Sidebar : public Component
 
     void updateConsole();
 
+    //! @brief Shows the objects that take the most dsp time in place of the console, while profiling is enabled.
+    void showProfiler(bool show);
+
+    // Called with the latest loads while the profiler is shown, and when an object is picked from its list
+    std::function<void(std::vector<pd::Profiler::Load> const&)> onProfileUpdate;
+    std::function<void(void*)> onProfileSelect;
+
    private:
     ObjectParameters lastParameters;
 
     Console* console;
     Inspector* inspector;
+    ProfilerPanel* profiler;
 
     static constexpr int dragbarWidth = 11;
     int dragStartWidth = 0;
@@ -78,6 +89,7 @@ struct Sidebar : public Component
     bool sidebarHidden = false;
 
     bool pinned = false;
+    bool profiling = false;
 
     int lastWidth = 250;
 };
@@ -158,6 +158,8 @@ Statusbar::Statusbar(PlugDataAudioProcessor& processor) : pd(processor)
     presentationButton = std::make_unique<TextButton>(Icons::Presentation);
      
     backgroundColour = std::make_unique<TextButton>(Icons::Colour);
+    parallelButton = std::make_unique<TextButton>(Icons::Parallel);
+    profilerButton = std::make_unique<TextButton>(Icons::Profiler);
 
     backgroundColour->setTooltip("Background Colour");
     backgroundColour->setConnectedEdges(12);
@@ -170,15 +172,37 @@ Statusbar::Statusbar(PlugDataAudioProcessor& processor) : pd(processor)
         colourSelector->setSize(300, 400);
         colourSelector->setColour(ColourSelector::backgroundColourId, findColour(ComboBox::backgroundColourId));
         
-        auto memblock = dynamic_cast<PlugDataPluginEditor*>(pd.getActiveEditor())->getCurrentCanvas()->patch.getExtraInfo("BackgroundColour");
-        auto stream = MemoryInputStream(std::move(memblock));
-
-        colourSelector->setCurrentColour(Colour::fromString(stream.readString()));
+        colourSelector->setCurrentColour(dynamic_cast<PlugDataPluginEditor*>(pd.getActiveEditor())->getCurrentCanvas()->backgroundColour);
 
         CallOutBox::launchAsynchronously(std::move(colourSelector), backgroundColour->getScreenBounds(), nullptr);
     };
     addAndMakeVisible(backgroundColour.get());
+
+    parallelButton->setTooltip("Run independent subpatches and clones in parallel");
+    parallelButton->setClickingTogglesState(true);
+    parallelButton->setConnectedEdges(12);
+    parallelButton->setName("statusbar:parallel");
+    parallelButton->setToggleState(pd.isParallelDspEnabled(), dontSendNotification);
+    parallelButton->onClick = [this]() { pd.setParallelDspEnabled(parallelButton->getToggleState()); };
+    addAndMakeVisible(parallelButton.get());
     
+    profilerButton->setTooltip("Profile DSP");
+    profilerButton->setClickingTogglesState(true);
+    profilerButton->setConnectedEdges(12);
+    profilerButton->setName("statusbar:profiler");
+    profilerButton->setToggleState(pd.isProfilingEnabled(), dontSendNotification);
+    profilerButton->onClick = [this]()
+    {
+        bool profiling = profilerButton->getToggleState();
+        pd.setProfilingEnabled(profiling);
+
+        if (auto* editor = dynamic_cast<PlugDataPluginEditor*>(pd.getActiveEditor()))
+        {
+            editor->sidebar.showProfiler(profiling);
+        }
+    };
+    addAndMakeVisible(profilerButton.get());
+
     presentationButton->setTooltip("Presentation Mode");
     presentationButton->setClickingTogglesState(true);
     presentationButton->setConnectedEdges(12);
@@ -288,6 +312,7 @@ void Statusbar::changeListenerCallback(ChangeBroadcaster* source)
     auto* cnv = dynamic_cast<PlugDataPluginEditor*>(pd.getActiveEditor())->getCurrentCanvas();
 
     cnv->patch.setExtraInfo("BackgroundColour", block);
+    cnv->backgroundColour = cs->getCurrentColour();
     cnv->repaint();
     for(auto& box : cnv->boxes) {
         box->repaint();
@@ -313,6 +338,9 @@ void Statusbar::resized()
     
     backgroundColour->setBounds(256, 0, getHeight(), getHeight());
 
+    parallelButton->setBounds(284, 0, getHeight(), getHeight());
+    profilerButton->setBounds(312, 0, getHeight(), getHeight());
+
     bypassButton->setBounds(getWidth() - 30, 0, getHeight(), getHeight());
 
     levelMeter->setBounds(getWidth() - 133, 1, 100, getHeight());